@@ -6,12 +6,16 @@
 * $Id: Logger.cc,v 1.3 2008/01/15 15:41:13 s2946182 Exp $
 */
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <cstdlib>
 
 #include "Logger.h"
+#include "binary_log.h"
 #include "exceptions.h"
 #include "ProgramOptions.h"
 #ifdef HAVE_GIT_SHA1
@@ -66,6 +70,53 @@ util::ProgramOption channelToFile(
 		"\"--show-log-channels\".",
 		util::_argument_sketch = "files");
 
+util::ProgramOption logFileSize(
+		util::_module = "Logging",
+		util::_long_name = "log-file-size",
+		util::_description_text =
+		"Start a new file for a channel redirected with --log-file-c if the "
+		"file would grow beyond the given number of bytes. The previous files "
+		"are renamed to file.1, file.2, and so on. 0 (the default) for no "
+		"limit.",
+		util::_argument_sketch = "bytes",
+		util::_default_value = 0);
+
+util::ProgramOption logFileAge(
+		util::_module = "Logging",
+		util::_long_name = "log-file-age",
+		util::_description_text =
+		"Start a new file for a channel redirected with --log-file-c after the "
+		"given number of seconds. 0 (the default) for no limit.",
+		util::_argument_sketch = "seconds",
+		util::_default_value = 0);
+
+util::ProgramOption logFileCount(
+		util::_module = "Logging",
+		util::_long_name = "log-file-count",
+		util::_description_text =
+		"The maximal number of files to keep per redirected channel, "
+		"including the current one. Older files are deleted.",
+		util::_argument_sketch = "files",
+		util::_default_value = 5);
+
+util::ProgramOption logFileBuffer(
+		util::_module = "Logging",
+		util::_long_name = "log-file-buffer",
+		util::_description_text =
+		"The size of the buffer in which lines for a log file are collected "
+		"before they are written.",
+		util::_argument_sketch = "bytes",
+		util::_default_value = 1024*1024);
+
+util::ProgramOption logFileFlushInterval(
+		util::_module = "Logging",
+		util::_long_name = "log-file-flush-interval",
+		util::_description_text =
+		"How often the buffers of log files are written, in milliseconds. "
+		"Error messages are written immediately.",
+		util::_argument_sketch = "ms",
+		util::_default_value = 1000);
+
 util::ProgramOption showChannelPrefix(
 		util::_module = "Logging",
 		util::_long_name = "show-channel-prefix",
@@ -81,6 +132,48 @@ util::ProgramOption showThreadId(
 		"Show the thread id in the channel prefix for every line of output."
 		"False by default.");
 
+util::ProgramOption logAsync(
+		util::_module = "Logging",
+		util::_long_name = "log-async",
+		util::_description_text =
+		"Write log messages in a background thread. Logging threads only "
+		"queue their lines and do not wait for the terminal or files.");
+
+util::ProgramOption logQueueSize(
+		util::_module = "Logging",
+		util::_long_name = "log-queue-size",
+		util::_description_text =
+		"The number of lines the queue of --log-async can hold.",
+		util::_argument_sketch = "lines",
+		util::_default_value = 16384);
+
+util::ProgramOption logQueueFull(
+		util::_module = "Logging",
+		util::_long_name = "log-queue-full",
+		util::_description_text =
+		"What to do with a line if the queue of --log-async is full: "
+		"\"block\" (wait for the writer, default) or \"drop\" (discard the "
+		"line and report the number of discarded lines).",
+		util::_argument_sketch = "policy",
+		util::_default_value = "block");
+
+util::ProgramOption logBinary(
+		util::_module = "Logging",
+		util::_long_name = "log-binary",
+		util::_description_text =
+		"Write the messages of LOG_BINARY statements of the given channels in "
+		"binary form to --log-binary-file, to be formatted later with the "
+		"tool log_decode.\n"
+		"channels syntax: channel1,channel2,...",
+		util::_argument_sketch = "channels");
+
+util::ProgramOption logBinaryFile(
+		util::_module = "Logging",
+		util::_long_name = "log-binary-file",
+		util::_description_text = "The file for --log-binary.",
+		util::_argument_sketch = "file",
+		util::_default_value = "log.bin");
+
 Logger glutton(0, "");
 
 // Initialize global logging-streams:
@@ -92,7 +185,7 @@ LogLevel  all   = All;
 LogChannel  out("default");
 
 // Declare static objects
-std::map<std::string, std::filebuf*>  LogFileManager::filebuffers;
+std::map<std::string, RotatingFileBuffer*>  LogFileManager::filebuffers;
 LogLevel                              LogManager::globalLogLevel = User;
 LogFileManager                        LogChannel::logFileManager;
 std::set<LogChannel*>*                LogChannel::logChannels = 0;
@@ -108,8 +201,12 @@ LogChannel::LogChannel(std::string channelName, std::string prefix) :
   _user(std::cout.rdbuf(), _prefix),
   _debug(std::cout.rdbuf(), _prefix),
   _all(std::cout.rdbuf(), _prefix),
-  _level(Global)
+  _level(Global),
+  _maxLevel(All),
+  _binary(false)
 {
+  _error.setUrgent(true);
+
   getChannels()->insert(this);
 }
 
@@ -125,9 +222,7 @@ LogChannel::getChannels() {
 Logger&
 LogChannel::operator()(LogLevel level) {
 
-  LogLevel  myLevel =
-    (_level == Global ?
-      LogManager::getGlobalLogLevel() : _level);
+  LogLevel  myLevel = getLogLevel();
 
   switch (level) {
     case Error:
@@ -158,13 +253,12 @@ LogChannel::setLogLevel(LogLevel level) {
   _level = level;
 }
 
-const LogLevel&
+LogLevel
 LogChannel::getLogLevel() {
 
-  if (_level == Global)
-    return LogManager::getGlobalLogLevel();
+  LogLevel level = (_level == Global ? LogManager::getGlobalLogLevel() : _level);
 
-  return _level;
+  return std::min(level, _maxLevel);
 }
 
 void
@@ -182,23 +276,30 @@ LogChannel::redirectToFile(std::string filename) {
 
 LogFileManager::~LogFileManager() {
 
-  std::map<std::string, std::filebuf*>::iterator i;
+  std::map<std::string, RotatingFileBuffer*>::iterator i;
 
-  for (i = filebuffers.begin(); i !=  filebuffers.end(); i++) {
-    (*i).second->close();
+  for (i = filebuffers.begin(); i !=  filebuffers.end(); i++)
     delete (*i).second;
-  }
 }
 
-std::filebuf*
+RotatingFileBuffer*
 LogFileManager::openFile(std::string filename) {
 
   if (filebuffers.find(filename) != filebuffers.end())
     return filebuffers[filename];
 
-  std::filebuf* filebuffer = new std::filebuf();
-  if (!filebuffer->open(filename.c_str(), std::ios_base::out)) {
+  RotatingFileBuffer* filebuffer =
+      new RotatingFileBuffer(
+          filename,
+          logFileSize.as<size_t>(),
+          std::chrono::seconds(logFileAge.as<long>()),
+          logFileCount.as<unsigned int>(),
+          logFileBuffer.as<size_t>(),
+          std::chrono::milliseconds(logFileFlushInterval.as<long>()));
+
+  if (!filebuffer->isOpen()) {
 
+    delete filebuffer;
     LOG_ERROR(out) << "[LogFileManager] Unable to open \"" << filename << "\"" << std::endl;
     BOOST_THROW_EXCEPTION(IOError() << error_message(std::string("[LogFileManager] Attempt to open file \"") + filename + "\" failed."));
   }
@@ -213,20 +314,125 @@ boost::mutex Logger::FlushMutex;
 bool Logger::_showChannelPrefix = true;
 bool Logger::_showThreadId      = false;
 
+thread_local LogStream** Logger::_threadStreams    = 0;
+thread_local size_t      Logger::_numThreadStreams = 0;
+
+namespace {
+
+// the number of Logger objects created so far
+std::atomic<size_t> numLoggers(0);
+
+// owns the streams of one thread
+struct ThreadStreams {
+
+  ~ThreadStreams() {
+
+    for (size_t i = 0; i < streams.size(); i++)
+      delete streams[i];
+  }
+
+  std::vector<LogStream*> streams;
+};
+
+thread_local bool threadStreamsReleased = false;
+
+} // anonymous namespace
+
 Logger::Logger(std::streambuf* streamBuffer, const std::string& prefix) :
   std::ostream(streamBuffer),
-  _prefix(prefix)
+  _prefix(prefix),
+  _index(numLoggers++),
+  _urgent(false)
 {
   // Empty
 }
 
 Logger::Logger(Logger& logger, const std::string& prefix) :
   std::ostream(logger.rdbuf()),
-  _prefix(prefix)
+  _prefix(prefix),
+  _index(numLoggers++),
+  _urgent(false)
 {
   // Empty
 }
 
+LogStream&
+Logger::createStream() {
+
+  // threads that log from destructors of thread local objects after their
+  // streams were released share one stream for all loggers, which is never
+  // deleted
+  if (threadStreamsReleased) {
+
+    static thread_local LogStream* stream = 0;
+    static thread_local Logger*    owner  = 0;
+
+    if (!stream)
+      stream = new LogStream();
+
+    // start with the prefix of the logger that uses the stream now
+    if (owner != this) {
+
+      owner = this;
+      clearBuffer();
+    }
+
+    return *stream;
+  }
+
+  struct Release {
+
+    ~Release() {
+
+      threadStreamsReleased = true;
+      _threadStreams        = 0;
+      _numThreadStreams     = 0;
+    }
+  };
+
+  static thread_local ThreadStreams threadStreams;
+  static thread_local Release       release;
+
+  std::vector<LogStream*>& streams = threadStreams.streams;
+
+  if (_index >= streams.size())
+    streams.resize(_index + 1, 0);
+
+  streams[_index]   = new LogStream();
+  _threadStreams    = &streams[0];
+  _numThreadStreams = streams.size();
+
+  clearBuffer();
+
+  return *streams[_index];
+}
+
+void
+Logger::outputRepeated(uint64_t repeats) {
+
+  std::stringstream line;
+
+  if (_showChannelPrefix) {
+
+    if (_showThreadId)
+      line << getThreadId() << " ";
+
+    line << _prefix;
+  }
+
+  line << "last message repeated " << repeats << " times" << std::endl;
+
+  output(line.str().data(), line.str().size());
+}
+
+const std::string&
+Logger::getThreadId() {
+
+  static thread_local std::string threadId = boost::lexical_cast<std::string>(boost::this_thread::get_id());
+
+  return threadId;
+}
+
 Logger&
 Logger::operator=(const Logger& logger) {
 
@@ -263,6 +469,18 @@ LogManager::init()
   Logger::showChannelPrefix(showChannelPrefix);
   Logger::showThreadId(showThreadId);
 
+  if (logAsync) {
+
+    std::string policy = logQueueFull;
+
+    if (policy != "block" && policy != "drop")
+      BOOST_THROW_EXCEPTION(UsageError() << error_message(std::string("[LogManager] Invalid queue policy: ") + policy));
+
+    AsyncLogWriter::start(
+        logQueueSize.as<size_t>(),
+        (policy == "drop" ? AsyncLogWriter::Drop : AsyncLogWriter::Block));
+  }
+
   // set channel log levels
   if (channelLevel) {
     
@@ -343,6 +561,28 @@ LogManager::init()
     }
  }
  
+  // write channels in binary form
+  if (logBinary) {
+
+    BinaryLog::open(logBinaryFile);
+
+    std::string channelNames = logBinary;
+
+    while (channelNames.length() > 0) {
+
+      size_t pos_co = channelNames.find_first_of(",");
+      std::string name = channelNames.substr(0, pos_co);
+      channelNames = (pos_co == std::string::npos ? "" : channelNames.substr(pos_co + 1));
+
+      std::set<LogChannel*> channels = getChannels(name);
+      for (channel_it i = channels.begin(); i != channels.end(); i++)
+          (*i)->setBinary(true);
+
+      LOG_DEBUG(out) << "[LogManager] channel \"" << name
+                     << "\" writes binary to \"" << logBinaryFile.as<std::string>() << "\"" << std::endl;
+    }
+  }
+
 #ifdef HAVE_GIT_SHA1
 	LOG_USER(out) << "[LogManager] git sha1 of this build: " << __git_sha1 << std::endl;
 #endif
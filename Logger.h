@@ -19,17 +19,53 @@
 #include <boost/lexical_cast.hpp>
 
 #include <config.h>
+#include "async_log_writer.h"
+#include "flight_recorder.h"
+#include "log_buffer.h"
+#include "log_callsite.h"
+#include "rotating_file_buffer.h"
 
-#define LOG_ERROR(channel) if (channel.getLogLevel() >= logger::Error) channel(logger::error)
-#define LOG_USER(channel)  if (channel.getLogLevel() >= logger::User)  channel(logger::user)
+/**
+ * The log statements test the level of the channel at compile time first: if
+ * the channel is a CappedLogChannel with a maximal level below the level of
+ * the statement, or if ENABLE_DEBUG_LOGGING is not defined for LOG_DEBUG and
+ * LOG_ALL, the condition is a constant false and the statement is compiled
+ * out.
+ */
+#define LOG_ERROR(channel) if (logger::MaxLogLevel<decltype(channel)>::value >= logger::Error && channel.getLogLevel() >= logger::Error) channel(logger::error)
+#define LOG_USER(channel)  if (logger::MaxLogLevel<decltype(channel)>::value >= logger::User  && channel.getLogLevel() >= logger::User)  channel(logger::user)
+#define LOG_DEBUG(channel) if (logger::MaxLogLevel<decltype(channel)>::value >= logger::Debug && channel.getLogLevel() >= logger::Debug) channel(logger::debug)
+#define LOG_ALL(channel)   if (logger::MaxLogLevel<decltype(channel)>::value >= logger::All   && channel.getLogLevel() >= logger::All)   channel(logger::all)
 
-#ifdef ENABLE_DEBUG_LOGGING
-#define LOG_DEBUG(channel) if (channel.getLogLevel() >= logger::Debug) channel(logger::debug)
-#define LOG_ALL(channel)   if (channel.getLogLevel() >= logger::All)   channel(logger::all)
-#else
-#define LOG_DEBUG(channel) if (false) channel(logger::debug)
-#define LOG_ALL(channel)   if (false) channel(logger::all)
-#endif
+/**
+ * Rate limited log statements, for messages that might be repeated in a loop,
+ * e.g.,
+ *
+ *   LOG_ERROR_LIMITED(solverlog, 10, 100) << "no solution for " << x << std::endl;
+ *
+ * writes at most 10 lines per second on average, with bursts of up to 100
+ * lines, and reports the number of suppressed lines with the next written
+ * line. Lines that equal the previous line of the statement are collapsed
+ * into "last message repeated N times". A rate of 0 disables the rate limit,
+ * such that only repeated lines are collapsed. The rate and burst have to be
+ * constants, the state is kept in a static LogCallsite at the statement.
+ * Every line has to end with std::endl. The repeats of a line are reported
+ * when the statement writes a different line, when it writes again after a
+ * second without lines, or at exit.
+ */
+#define LOG_ERROR_LIMITED(channel, linesPerSecond, burst) LOG_LIMITED_(channel, Error, error, linesPerSecond, burst)
+#define LOG_USER_LIMITED(channel, linesPerSecond, burst)  LOG_LIMITED_(channel, User,  user,  linesPerSecond, burst)
+#define LOG_DEBUG_LIMITED(channel, linesPerSecond, burst) LOG_LIMITED_(channel, Debug, debug, linesPerSecond, burst)
+#define LOG_ALL_LIMITED(channel, linesPerSecond, burst)   LOG_LIMITED_(channel, All,   all,   linesPerSecond, burst)
+
+#define LOG_LIMITED_(channel, level, stream, linesPerSecond, burst) \
+	if (logger::MaxLogLevel<decltype(channel)>::value >= logger::level && \
+	    channel.getLogLevel() >= logger::level && \
+	    []() -> logger::LogCallsite& { \
+	      static logger::LogCallsite util_log_callsite_(__FILE__, __LINE__, linesPerSecond, burst); \
+	      return util_log_callsite_; \
+	    }().enter(channel(logger::stream))) \
+		channel(logger::stream)
 
 
 namespace logger {
@@ -77,10 +113,19 @@ public:
 		_showThreadId = show;
 	}
 
+	/**
+	 * Write the lines of this logger to files immediately, instead of when the
+	 * buffer of the file is written. Used for error messages.
+	 */
+	void setUrgent(bool urgent) {
+
+		_urgent = urgent;
+	}
+
 	template <typename T>
 	Logger& operator<<(T* t) {
 
-		getBuffer() << t;
+		getStream().format(t);
 
 		return *this;
 	}
@@ -88,25 +133,26 @@ public:
 	template <typename T>
 	Logger& operator<<(const T& t) {
 
-		getBuffer() << t;
+		getStream().format(t);
 
 		return *this;
 	}
 
-	Logger& operator<<(Manip op) {
+	Logger& operator<<(const char* s) {
 
-		if (op == delline) {
+		getStream().format(s);
 
-			{
-				boost::mutex::scoped_lock lock(FlushMutex);
+		return *this;
+	}
 
-				std::ostream& s = *this;
+	Logger& operator<<(Manip op) {
 
-				// send cursor back
-				s << "\33[2K\r";
+		if (op == delline) {
 
-				clearBuffer();
-			}
+			// send cursor back
+			output("\33[2K\r", 5);
+
+			clearBuffer();
 		}
 
 		return *this;
@@ -114,19 +160,27 @@ public:
 
 	Logger& operator<<(std::ostream&(*fp)(std::ostream&)) {
 
-		getBuffer() << fp;
+		LogStream& stream = getStream();
+
+		stream << fp;
 
 		// the next operator<< will cause the prefix to be printed after a 
 		// newline
 		if (fp == &std::endl<std::ostream::char_type, std::ostream::traits_type>) {
 
-			{
-				boost::mutex::scoped_lock lock(FlushMutex);
+			LogCallsite* site    = LogCallsite::leave();
+			uint64_t     repeats = 0;
+
+			// drop lines of a rate limited statement that equal its previous
+			// line
+			if (!site || !site->repeated(stream.buffer().data(), stream.buffer().size(), repeats)) {
+
+				if (repeats > 0)
+					outputRepeated(repeats);
 
-				std::ostream& s = *this;
+				FlightRecorder::mark(stream.buffer().data(), stream.buffer().size());
 
-				s << getBuffer().str();
-				s << std::flush;
+				output(stream.buffer().data(), stream.buffer().size());
 			}
 
 			clearBuffer();
@@ -135,17 +189,10 @@ public:
 		// flush the buffer content
 		if (fp == &std::flush<std::ostream::char_type, std::ostream::traits_type>) {
 
-			{
-				boost::mutex::scoped_lock lock(FlushMutex);
-
-				std::ostream& s = *this;
-
-				s << getBuffer().str();
-				s << std::flush;
-			}
+			output(stream.buffer().data(), stream.buffer().size());
 
 			// clear the current buffer
-			getBuffer().str("");
+			stream.buffer().clear();
 		}
 
 		return *this;
@@ -153,47 +200,72 @@ public:
 
 	Logger& operator<<(std::ios&(*fp)(std::ios&)) {
 
-		getBuffer() << fp;
+		getStream() << fp;
 
 		return *this;
 	}
 
 	Logger& operator<<(std::ios_base&(*fp)(std::ios_base&)) {
 
-		getBuffer() << fp;
+		getStream() << fp;
 
 		return *this;
 	}
 
 private:
 
-	std::stringstream& getBuffer() {
-
-		if (_buffer.get() == 0) {
+	// the stream of the current thread for this logger
+	LogStream& getStream() {
 
-			_buffer.reset(new std::stringstream());
-			clearBuffer();
-		}
+		if (_index < _numThreadStreams && _threadStreams[_index])
+			return *_threadStreams[_index];
 
-		return (*_buffer);
+		return createStream();
 	}
 
+	LogStream& createStream();
+
 	void clearBuffer() {
 
-		getBuffer().str("");
+		LogBuffer& buffer = getStream().buffer();
+
+		buffer.clear();
 
 		if (_showChannelPrefix) {
 
 			// fill the buffer with the prefix
-			getBuffer() << getPrefix();
+			if (_showThreadId) {
+
+				const std::string& threadId = getThreadId();
+				buffer.append(threadId.data(), threadId.size());
+				buffer.append(' ');
+			}
+
+			buffer.append(_prefix.data(), _prefix.size());
 		}
 	}
 
-	std::string getPrefix() {
+	// the id of the current thread as text
+	static const std::string& getThreadId();
+
+	// write "last message repeated <repeats> times"
+	void outputRepeated(uint64_t repeats);
+
+	// write the given characters to the stream buffer, or hand them to the
+	// AsyncLogWriter
+	void output(const char* data, size_t length) {
 
-		if (_showThreadId)
-			return boost::lexical_cast<std::string>(boost::this_thread::get_id()) + " " + _prefix;
-		return _prefix;
+		if (AsyncLogWriter::push(rdbuf(), data, length, _urgent) || !rdbuf())
+			return;
+
+		boost::mutex::scoped_lock lock(FlushMutex);
+
+		rdbuf()->sputn(data, length);
+
+		if (_urgent)
+			RotatingFileBuffer::flushNow(rdbuf());
+		else
+			rdbuf()->pubsync();
 	}
 
 	// reference to the owning LogChannel's prefix
@@ -203,10 +275,20 @@ private:
 	static bool _showChannelPrefix;
 	static bool _showThreadId;
 
-	// thread local buffer
-	boost::thread_specific_ptr<std::stringstream> _buffer;
+	// the index of this logger in _threadStreams
+	size_t _index;
+
+	bool _urgent;
+
+	// the streams of the current thread, indexed by logger, created on first
+	// use and reused for all lines
+	static thread_local LogStream** _threadStreams;
+	static thread_local size_t      _numThreadStreams;
 
 	static boost::mutex FlushMutex;
+
+	// writes lines while holding FlushMutex
+	friend class AsyncLogWriter;
 };
 
 class LogFileManager {
@@ -215,11 +297,11 @@ class LogFileManager {
 
     ~LogFileManager();
 
-    static std::filebuf* openFile(std::string filename);
+    static RotatingFileBuffer* openFile(std::string filename);
 
   private:
 
-    static std::map<std::string, std::filebuf*> filebuffers;
+    static std::map<std::string, RotatingFileBuffer*> filebuffers;
 
     static LogLevel getLogLevel(std::string loglevel);
 
@@ -244,10 +326,24 @@ class LogChannel {
 
     void  setLogLevel(LogLevel level);
 
-    const LogLevel& getLogLevel();
+    // the level of this channel, at most its maximal level
+    LogLevel getLogLevel();
 
     void  redirectToFile(std::string filename);
 
+    const std::string& getPrefix() { return _prefix; }
+
+    // write the messages of LOG_BINARY in binary form, see BinaryLog
+    void  setBinary(bool binary) { _binary = binary; }
+
+    bool  isBinary() const { return _binary; }
+
+  protected:
+
+    // limit the level of this channel, independent of setLogLevel(), used by
+    // CappedLogChannel
+    void  setMaxLogLevel(LogLevel level) { _maxLevel = level; }
+
   private:
 
     friend struct LoggerCleanup;
@@ -269,8 +365,63 @@ class LogChannel {
     Logger  _all;
 
     LogLevel  _level;
+
+    LogLevel  _maxLevel;
+
+    bool  _binary;
 };
 
+/**
+ * A channel whose level can not exceed MaxLevel. The log statements of higher
+ * levels on this channel are removed at compile time, e.g.,
+ *
+ *   logger::CappedLogChannel<logger::User> solverlog("solverlog", "[Solver] ");
+ *
+ *   LOG_DEBUG(solverlog) << "not compiled" << std::endl;
+ *
+ * MaxLevel can be given by a preprocessor definition to keep the debug output
+ * of a channel only in some builds.
+ */
+template <LogLevel MaxLevel>
+class CappedLogChannel : public LogChannel {
+
+  public:
+
+    CappedLogChannel(std::string channelName, std::string prefix = "") :
+      LogChannel(channelName, prefix) {
+
+      setMaxLogLevel(MaxLevel);
+    }
+};
+
+#ifdef ENABLE_DEBUG_LOGGING
+const LogLevel DefaultMaxLogLevel = All;
+#else
+const LogLevel DefaultMaxLogLevel = User;
+#endif
+
+/**
+ * The maximal level of a channel type known at compile time, used by the
+ * LOG_* macros.
+ */
+template <typename Channel>
+struct MaxLogLevel {
+
+	static const LogLevel value = DefaultMaxLogLevel;
+};
+
+template <LogLevel MaxLevel>
+struct MaxLogLevel<CappedLogChannel<MaxLevel> > {
+
+	static const LogLevel value = (MaxLevel < DefaultMaxLogLevel ? MaxLevel : DefaultMaxLogLevel);
+};
+
+template <typename Channel>
+struct MaxLogLevel<Channel&> : public MaxLogLevel<Channel> {};
+
+template <typename Channel>
+struct MaxLogLevel<const Channel> : public MaxLogLevel<Channel> {};
+
 class LogManager {
 
   public:
@@ -1,4 +1,5 @@
 #include "SignalHandler.h"
+#include "flight_recorder.h"
 
 namespace util {
 
@@ -7,6 +8,8 @@ logger::LogChannel signalhandlerlog("signalhandlerlog", "[SignalHandler] ");
 void
 SignalHandler::init() {
 
+	FlightRecorder::init();
+
 #if defined(SYSTEM_UNIX) && !defined(SYSTEM_MAC)
 	struct sigaction sa;
 	sa.sa_handler = handle_signal;
@@ -27,6 +30,10 @@ void
 SignalHandler::handle_signal(int signal) {
 
 #if defined(SYSTEM_UNIX) && !defined(SYSTEM_MAC)
+	// first, while the process is still in a sane state
+	if (signal == SIGSEGV || signal == SIGABRT)
+		FlightRecorder::dump();
+
 	if (signal == SIGSEGV) {
 
 		LOG_ERROR(signalhandlerlog) << "got segfault at:" << std::endl;
@@ -0,0 +1,103 @@
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+#include "allocation_tracker.h"
+
+std::atomic<bool> AllocationTracker::_enabled(false);
+
+namespace {
+
+// a plain struct without constructor, such that it can be used from operator
+// new before any thread-local initialization happened
+thread_local AllocationTracker::Counts counts = { 0, 0, 0, 0 };
+
+} // anonymous namespace
+
+AllocationTracker::Counts&
+AllocationTracker::threadCounts() {
+
+	return counts;
+}
+
+#ifdef UTIL_ALLOCATION_TRACKER
+
+bool
+AllocationTracker::isAvailable() {
+
+	return true;
+}
+
+namespace {
+
+inline void* allocate(std::size_t size) {
+
+	if (size == 0)
+		size = 1;
+
+	void* p;
+	while ((p = std::malloc(size)) == 0) {
+
+		std::new_handler handler = std::get_new_handler();
+		if (!handler)
+			throw std::bad_alloc();
+		handler();
+	}
+
+	if (AllocationTracker::isEnabled()) {
+
+		counts.allocations++;
+		counts.bytes += size;
+		counts.live  += malloc_usable_size(p);
+		if (counts.live > counts.peak)
+			counts.peak = counts.live;
+	}
+
+	return p;
+}
+
+inline void* allocate(std::size_t size, const std::nothrow_t&) noexcept {
+
+	try {
+
+		return allocate(size);
+
+	} catch (std::bad_alloc&) {
+
+		return 0;
+	}
+}
+
+inline void deallocate(void* p) noexcept {
+
+	if (!p)
+		return;
+
+	if (AllocationTracker::isEnabled())
+		counts.live -= malloc_usable_size(p);
+
+	std::free(p);
+}
+
+} // anonymous namespace
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t& nothrow) noexcept { return allocate(size, nothrow); }
+void* operator new[](std::size_t size, const std::nothrow_t& nothrow) noexcept { return allocate(size, nothrow); }
+
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::size_t) noexcept { deallocate(p); }
+
+#else // UTIL_ALLOCATION_TRACKER
+
+bool
+AllocationTracker::isAvailable() {
+
+	return false;
+}
+
+#endif // UTIL_ALLOCATION_TRACKER
@@ -0,0 +1,62 @@
+#ifndef UTIL_ALLOCATION_TRACKER_H__
+#define UTIL_ALLOCATION_TRACKER_H__
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Counts the heap allocations of each thread by replacing the global operator
+ * new and delete.
+ *
+ * The replacement operators are only compiled in if util is built with the
+ * CMake option BUILD_UTIL_ALLOCATION_TRACKER (which defines
+ * UTIL_ALLOCATION_TRACKER), and count only while tracking is enabled with
+ * setEnabled() or the option --timing-allocations. Live bytes are measured
+ * with malloc_usable_size(). Memory freed by another thread than the one that
+ * allocated it is subtracted from the live bytes of the freeing thread.
+ */
+class AllocationTracker {
+
+public:
+
+	/**
+	 * The allocation counters of one thread.
+	 */
+	struct Counts {
+
+		// the number of calls to operator new
+		uint64_t allocations;
+
+		// the number of bytes requested with operator new
+		uint64_t bytes;
+
+		// the number of bytes currently allocated by this thread
+		int64_t live;
+
+		// the highest value of live since the last call to resetPeak()
+		int64_t peak;
+	};
+
+	/**
+	 * True, if the replacement operators are compiled in.
+	 */
+	static bool isAvailable();
+
+	/**
+	 * Start or stop counting allocations in all threads.
+	 */
+	static void setEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+	static bool isEnabled() { return _enabled.load(std::memory_order_relaxed); }
+
+	/**
+	 * The counters of the calling thread.
+	 */
+	static Counts& threadCounts();
+
+private:
+
+	static std::atomic<bool> _enabled;
+};
+
+#endif // UTIL_ALLOCATION_TRACKER_H__
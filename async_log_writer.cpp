@@ -0,0 +1,300 @@
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include "Logger.h"
+#include "async_log_writer.h"
+
+namespace logger {
+
+const size_t AsyncLogWriter::Closed;
+
+std::unique_ptr<AsyncLogWriter::Slot[]> AsyncLogWriter::_slots;
+size_t                                  AsyncLogWriter::_mask = 0;
+AsyncLogWriter::Policy                  AsyncLogWriter::_policy = AsyncLogWriter::Block;
+std::atomic<size_t>                     AsyncLogWriter::_pushPos(0);
+size_t                                  AsyncLogWriter::_popPos = 0;
+std::atomic<size_t>                     AsyncLogWriter::_written(0);
+std::atomic<uint64_t>                   AsyncLogWriter::_dropped(0);
+std::atomic<bool>                       AsyncLogWriter::_running(false);
+std::atomic<bool>                       AsyncLogWriter::_stop(false);
+std::atomic<bool>                       AsyncLogWriter::_sleeping(false);
+std::mutex                              AsyncLogWriter::_mutex;
+std::condition_variable                 AsyncLogWriter::_wakeup;
+std::condition_variable                 AsyncLogWriter::_drained;
+std::thread                             AsyncLogWriter::_writer;
+
+void
+AsyncLogWriter::start(size_t queueSize, Policy policy) {
+
+	if (isRunning())
+		return;
+
+	size_t size = 2;
+	while (size < queueSize)
+		size *= 2;
+
+	_slots.reset(new Slot[size]);
+	_mask   = size - 1;
+	_policy = policy;
+
+	for (size_t i = 0; i < size; i++) {
+
+		_slots[i].sequence.store(i, std::memory_order_relaxed);
+
+		// enough for most lines, such that push() does not allocate
+		_slots[i].line.reserve(SlotCapacity);
+	}
+
+	_pushPos.store(0, std::memory_order_relaxed);
+	_popPos = 0;
+	_written.store(0, std::memory_order_relaxed);
+	_stop.store(false, std::memory_order_relaxed);
+
+	_writer = std::thread(run);
+	_running.store(true, std::memory_order_release);
+
+	// stop before the static objects (including _writer) are destructed
+	static bool registered = false;
+	if (!registered) {
+
+		std::atexit(stop);
+		registered = true;
+	}
+}
+
+void
+AsyncLogWriter::stop() {
+
+	if (!isRunning())
+		return;
+
+	// from now on, lines are written by the calling threads
+	_running.store(false, std::memory_order_release);
+
+	// threads that saw the writer running might still claim slots, close the
+	// queue such that they can not, and get the number of claimed slots
+	size_t pushed = _pushPos.fetch_or(Closed, std::memory_order_acq_rel);
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop.store(true, std::memory_order_relaxed);
+	}
+	_wakeup.notify_one();
+
+	_writer.join();
+
+	// lines of threads that claimed a slot before the queue was closed, but
+	// did not fill it yet
+	while (_popPos < pushed)
+		if (writeBatch() == 0)
+			std::this_thread::yield();
+}
+
+bool
+AsyncLogWriter::push(std::streambuf* target, const char* data, size_t length, bool urgent) {
+
+	if (!isRunning())
+		return false;
+
+	// like std::ostream without stream buffer, discard the line
+	if (!target)
+		return true;
+
+	while (!tryPush(target, data, length, urgent)) {
+
+		// the queue was closed by stop()
+		if (!isRunning())
+			return false;
+
+		if (_policy == Drop) {
+
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		// wait for the writer to make room
+		_wakeup.notify_one();
+		std::this_thread::yield();
+	}
+
+	// wake the writer, if it waits for lines
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (_sleeping.load(std::memory_order_relaxed)) {
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_wakeup.notify_one();
+	}
+
+	return true;
+}
+
+bool
+AsyncLogWriter::tryPush(std::streambuf* target, const char* data, size_t length, bool urgent) {
+
+	size_t pos = _pushPos.load(std::memory_order_relaxed);
+	Slot*  slot;
+
+	while (true) {
+
+		if (pos & Closed) {
+
+			// such that push() sees _running cleared by stop()
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return false;
+		}
+
+		slot = &_slots[pos & _mask];
+
+		size_t   sequence = slot->sequence.load(std::memory_order_acquire);
+		intptr_t diff     = (intptr_t)sequence - (intptr_t)pos;
+
+		if (diff == 0) {
+
+			// the slot is free, try to claim it
+			if (_pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+
+		} else if (diff < 0) {
+
+			// the writer did not consume this slot yet, the queue is full
+			return false;
+
+		} else {
+
+			// another thread claimed this position
+			pos = _pushPos.load(std::memory_order_relaxed);
+		}
+	}
+
+	slot->target = target;
+	slot->urgent = urgent;
+	slot->line.assign(data, length);
+
+	// hand the slot to the writer
+	slot->sequence.store(pos + 1, std::memory_order_release);
+
+	return true;
+}
+
+void
+AsyncLogWriter::flush() {
+
+	if (!isRunning())
+		return;
+
+	size_t pushed = _pushPos.load(std::memory_order_acquire) & ~Closed;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_wakeup.notify_one();
+
+	while (isRunning() && _written.load(std::memory_order_acquire) < pushed)
+		_drained.wait_for(lock, std::chrono::milliseconds(10));
+}
+
+void
+AsyncLogWriter::run() {
+
+	while (true) {
+
+		if (writeBatch() > 0)
+			continue;
+
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		if (_stop.load(std::memory_order_relaxed))
+			break;
+
+		// sleep until push() sees _sleeping and wakes us up, or for 10ms in
+		// case that wake-up was missed
+		_sleeping.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		const Slot& next = _slots[_popPos & _mask];
+		if (next.sequence.load(std::memory_order_acquire) != _popPos + 1)
+			_wakeup.wait_for(lock, std::chrono::milliseconds(10));
+
+		_sleeping.store(false, std::memory_order_relaxed);
+	}
+
+	// lines pushed after the last batch
+	writeBatch();
+}
+
+size_t
+AsyncLogWriter::writeBatch() {
+
+	static uint64_t                              reportedDrops = 0;
+	static std::chrono::steady_clock::time_point lastReport;
+
+	// the stream buffers written to in this batch, to be synced once
+	const int       MaxTargets = 8;
+	std::streambuf* targets[MaxTargets];
+	int             numTargets = 0;
+
+	size_t n = 0;
+
+	{
+		boost::mutex::scoped_lock lock(Logger::FlushMutex);
+
+		while (n <= _mask) {
+
+			Slot& slot = _slots[_popPos & _mask];
+
+			if (slot.sequence.load(std::memory_order_acquire) != _popPos + 1)
+				break;
+
+			slot.target->sputn(slot.line.data(), slot.line.size());
+
+			if (slot.urgent)
+				RotatingFileBuffer::flushNow(slot.target);
+
+			int t = 0;
+			while (t < numTargets && targets[t] != slot.target)
+				t++;
+			if (t == numTargets) {
+
+				if (numTargets == MaxTargets)
+					targets[--numTargets]->pubsync();
+				targets[numTargets++] = slot.target;
+			}
+
+			slot.line.clear();
+
+			// hand the slot back to the producers
+			slot.sequence.store(_popPos + _mask + 1, std::memory_order_release);
+
+			_popPos++;
+			n++;
+		}
+
+		// report dropped lines at most once per second
+		uint64_t                              dropped = _dropped.load(std::memory_order_relaxed);
+		std::chrono::steady_clock::time_point now     = std::chrono::steady_clock::now();
+
+		if (dropped > reportedDrops && (now - lastReport > std::chrono::seconds(1) || _stop.load(std::memory_order_relaxed))) {
+
+			std::stringstream message;
+			message << "[Logger] dropped " << (dropped - reportedDrops) << " log lines, the queue was full" << std::endl;
+			std::cerr.rdbuf()->sputn(message.str().data(), message.str().size());
+			std::cerr.rdbuf()->pubsync();
+
+			reportedDrops = dropped;
+			lastReport    = now;
+		}
+
+		for (int t = 0; t < numTargets; t++)
+			targets[t]->pubsync();
+	}
+
+	if (n > 0) {
+
+		_written.fetch_add(n, std::memory_order_release);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_drained.notify_all();
+	}
+
+	return n;
+}
+
+} // namespace logger
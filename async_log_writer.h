@@ -0,0 +1,128 @@
+#ifndef UTIL_ASYNC_LOG_WRITER_H__
+#define UTIL_ASYNC_LOG_WRITER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+namespace logger {
+
+/**
+ * Writes completed log lines in a background thread.
+ *
+ * If started (with --log-async or start()), Loggers push their lines onto a
+ * bounded lock-free queue instead of writing them to their stream buffer, and
+ * a single writer thread drains the queue in batches: all lines of a batch are
+ * written while holding Logger's flush mutex once, and every stream buffer is
+ * synced once per batch. The lines of one thread keep their order.
+ *
+ * If the queue is full, push() either waits for the writer (Block) or drops
+ * the line (Drop). The number of dropped lines is reported on std::cerr by the
+ * writer.
+ */
+class AsyncLogWriter {
+
+public:
+
+	enum Policy {
+
+		Block,
+		Drop
+	};
+
+	/**
+	 * Start the writer thread with a queue of at least the given number of
+	 * lines.
+	 */
+	static void start(size_t queueSize, Policy policy);
+
+	/**
+	 * Write all queued lines and stop the writer thread. Lines that are pushed
+	 * concurrently are either written before stop() returns or written by
+	 * their threads directly. Called at exit.
+	 */
+	static void stop();
+
+	static bool isRunning() { return _running.load(std::memory_order_acquire); }
+
+	/**
+	 * Queue a line to be written to the given stream buffer. The line is
+	 * copied into the queue, whose slots keep their memory, so pushing does not
+	 * allocate once every slot held a line of this length. Returns false if the
+	 * writer is not running, in which case the caller has to write the line
+	 * itself. Urgent lines are written to files immediately, see
+	 * RotatingFileBuffer::flushNow().
+	 */
+	static bool push(std::streambuf* target, const char* data, size_t length, bool urgent = false);
+
+	/**
+	 * Wait until all lines queued so far are written.
+	 */
+	static void flush();
+
+	/**
+	 * The number of lines dropped because the queue was full.
+	 */
+	static uint64_t dropped() { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+
+	// the initial capacity of the line of a slot
+	static const size_t SlotCapacity = 128;
+
+	struct Slot {
+
+		// the position in the queue this slot is ready for: pos for the
+		// producer, pos + 1 for the consumer
+		std::atomic<size_t> sequence;
+
+		std::streambuf* target;
+
+		bool urgent;
+
+		std::string line;
+	};
+
+	static bool tryPush(std::streambuf* target, const char* data, size_t length, bool urgent);
+
+	static void run();
+
+	// write up to one queue length of lines, returns the number written
+	static size_t writeBatch();
+
+	static std::unique_ptr<Slot[]> _slots;
+
+	static size_t _mask;
+
+	static Policy _policy;
+
+	// set in _pushPos by stop(), such that no more slots can be claimed
+	static const size_t Closed = ~(~size_t(0) >> 1);
+
+	// the next position to push to and to pop from
+	static std::atomic<size_t> _pushPos;
+	static size_t              _popPos;
+
+	static std::atomic<size_t> _written;
+
+	static std::atomic<uint64_t> _dropped;
+
+	static std::atomic<bool> _running;
+	static std::atomic<bool> _stop;
+	static std::atomic<bool> _sleeping;
+
+	static std::mutex              _mutex;
+	static std::condition_variable _wakeup;
+	static std::condition_variable _drained;
+
+	static std::thread _writer;
+};
+
+} // namespace logger
+
+#endif // UTIL_ASYNC_LOG_WRITER_H__
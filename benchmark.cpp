@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include "benchmark.h"
+
+util::ProgramOption optionBenchmarkFilter(
+		util::_module = "Benchmark",
+		util::_long_name = "benchmark-filter",
+		util::_description_text = "Run only benchmarks whose names contain the given string.",
+		util::_argument_sketch = "string");
+
+util::ProgramOption optionBenchmarkList(
+		util::_module = "Benchmark",
+		util::_long_name = "benchmark-list",
+		util::_description_text = "List the names of all benchmarks instead of running them.");
+
+util::ProgramOption optionBenchmarkMinTime(
+		util::_module = "Benchmark",
+		util::_long_name = "benchmark-min-time",
+		util::_description_text = "The minimal duration of one run of a benchmark in seconds.",
+		util::_argument_sketch = "seconds",
+		util::_default_value = 0.1);
+
+util::ProgramOption optionBenchmarkWarmup(
+		util::_module = "Benchmark",
+		util::_long_name = "benchmark-warmup",
+		util::_description_text =
+		"How long to run each benchmark before the measurement, in seconds. "
+		"Also used to estimate the number of iterations per run.",
+		util::_argument_sketch = "seconds",
+		util::_default_value = 0.05);
+
+util::ProgramOption optionBenchmarkRepetitions(
+		util::_module = "Benchmark",
+		util::_long_name = "benchmark-repetitions",
+		util::_description_text = "How often to repeat the measured run of each benchmark.",
+		util::_default_value = 5);
+
+namespace util {
+namespace benchmark {
+
+logger::LogChannel benchmarklog("benchmarklog", "[benchmark] ");
+
+namespace {
+
+// the upper limit of iterations per run
+const uint64_t MaxIterations = uint64_t(1) << 40;
+
+std::vector<std::unique_ptr<Benchmark> >& registry() {
+
+	static std::vector<std::unique_ptr<Benchmark> > benchmarks;
+
+	return benchmarks;
+}
+
+// the 97.5% quantile of Student's t-distribution with the given degrees of
+// freedom, for two-sided 95% confidence intervals
+double studentT(int df) {
+
+	static const double t[] = {
+		0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+		2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+		2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+
+	if (df < 1)
+		return 0;
+	if (df <= 30)
+		return t[df];
+
+	return 1.960;
+}
+
+// format a rate with a unit prefix
+std::string formatRate(double rate, const std::string& unit) {
+
+	static const char* prefixes[] = { "", "k", "M", "G", "T" };
+
+	int p = 0;
+	while (rate >= 1000 && p < 4) {
+
+		rate /= 1000;
+		p++;
+	}
+
+	std::stringstream s;
+	s << std::fixed << std::setprecision(2) << rate << " " << prefixes[p] << unit << "/s";
+
+	return s.str();
+}
+
+// format a time in seconds with a unit prefix
+std::string formatTime(double seconds) {
+
+	std::stringstream s;
+	s << std::fixed << std::setprecision(2);
+
+	if (seconds < 1e-6)
+		s << seconds*1e9 << " ns";
+	else if (seconds < 1e-3)
+		s << seconds*1e6 << " us";
+	else if (seconds < 1)
+		s << seconds*1e3 << " ms";
+	else
+		s << seconds << " s";
+
+	return s.str();
+}
+
+// run the benchmark once with the given number of iterations
+State runOnce(const Benchmark& benchmark, const std::string& name, int64_t arg, uint64_t iterations) {
+
+	State state(iterations, arg);
+	benchmark.run(state);
+
+	if (!state.stopped())
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"benchmark " << name << " did not run until keepRunning() returned false");
+
+	return state;
+}
+
+void runBenchmark(const Benchmark& benchmark, const std::string& name, int64_t arg) {
+
+	double minTime     = optionBenchmarkMinTime;
+	double warmupTime  = optionBenchmarkWarmup;
+	int    repetitions = std::max(1, optionBenchmarkRepetitions.as<int>());
+
+	// warm up with growing numbers of iterations, until the warm-up time is
+	// spent and the last run was long enough to estimate the time per
+	// iteration
+	double   spent      = 0;
+	uint64_t iterations = 1;
+	double   perIteration;
+
+	while (true) {
+
+		State state = runOnce(benchmark, name, arg, iterations);
+		spent += state.elapsed();
+		perIteration = state.elapsed()/iterations;
+
+		if ((spent >= warmupTime && state.elapsed() >= minTime/100) || iterations >= MaxIterations)
+			break;
+
+		iterations = std::min(MaxIterations, iterations*2);
+	}
+
+	iterations = std::min(MaxIterations, std::max<uint64_t>(1, std::ceil(minTime/std::max(perIteration, 1e-12))));
+
+	// measure
+	std::vector<double> times;
+	State last(0, arg);
+
+	for (int r = 0; r < repetitions; r++) {
+
+		last = runOnce(benchmark, name, arg, iterations);
+
+		double time = last.elapsed()/iterations;
+		times.push_back(time);
+
+		TimingStatistics::addTimer(name, time);
+	}
+
+	double mean = 0;
+	for (double t : times)
+		mean += t;
+	mean /= times.size();
+
+	double variance = 0;
+	for (double t : times)
+		variance += (t - mean)*(t - mean);
+	variance /= std::max<size_t>(1, times.size() - 1);
+
+	double confidence = studentT(times.size() - 1)*std::sqrt(variance/times.size());
+
+	// format in a separate stream, to not change the format of benchmarklog
+	std::stringstream line;
+	line
+			<< std::left << std::setw(40) << name << std::right
+			<< std::setw(12) << iterations << " iterations   "
+			<< std::setw(10) << formatTime(mean) << " +- "
+			<< std::setw(10) << formatTime(confidence)
+			<< " (" << std::fixed << std::setprecision(1) << std::setw(4) << (mean > 0 ? confidence/mean*100 : 0) << "%)"
+			<< std::defaultfloat << std::setprecision(6);
+
+	if (last.itemsPerIteration() > 0 && mean > 0)
+		line << "   " << formatRate(last.itemsPerIteration()/mean, "items");
+	if (last.bytesPerIteration() > 0 && mean > 0)
+		line << "   " << formatRate(last.bytesPerIteration()/mean, "B");
+	for (const auto& p : last.counters())
+		line << "   " << p.first << "=" << p.second;
+
+	LOG_USER(benchmarklog) << line.str() << std::endl;
+}
+
+} // anonymous namespace
+
+bool
+State::startOrStop() {
+
+	if (!_started) {
+
+		_started = true;
+		_begin   = Clock::now();
+
+		if (_remaining > 0) {
+
+			_remaining--;
+			return true;
+		}
+	}
+
+	// all iterations are done
+	if (!_stopped) {
+
+		if (!_paused)
+			_elapsed += std::chrono::duration<double>(Clock::now() - _begin).count();
+
+		_stopped = true;
+	}
+
+	return false;
+}
+
+void
+State::pauseTiming() {
+
+	if (_paused || !_started || _stopped)
+		return;
+
+	_elapsed += std::chrono::duration<double>(Clock::now() - _begin).count();
+	_paused   = true;
+}
+
+void
+State::resumeTiming() {
+
+	if (!_paused)
+		return;
+
+	_paused = false;
+	_begin  = Clock::now();
+}
+
+Benchmark*
+registerBenchmark(const std::string& name, Function function) {
+
+	registry().push_back(std::unique_ptr<Benchmark>(new Benchmark(name, function)));
+
+	return registry().back().get();
+}
+
+void
+runBenchmarks() {
+
+	std::string filter = (optionBenchmarkFilter ? optionBenchmarkFilter.as<std::string>() : std::string());
+
+	for (const std::unique_ptr<Benchmark>& benchmark : registry()) {
+
+		std::vector<int64_t> args = benchmark->getArgs();
+		bool withArgs = !args.empty();
+		if (!withArgs)
+			args.push_back(0);
+
+		for (int64_t arg : args) {
+
+			std::string name = benchmark->getName();
+			if (withArgs) {
+
+				std::stringstream s;
+				s << name << "/" << arg;
+				name = s.str();
+			}
+
+			if (!filter.empty() && name.find(filter) == std::string::npos)
+				continue;
+
+			if (optionBenchmarkList) {
+
+				LOG_USER(benchmarklog) << name << std::endl;
+				continue;
+			}
+
+			runBenchmark(*benchmark, name, arg);
+		}
+	}
+}
+
+} // namespace benchmark
+} // namespace util
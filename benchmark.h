@@ -0,0 +1,249 @@
+#ifndef UTIL_BENCHMARK_H__
+#define UTIL_BENCHMARK_H__
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Logger.h"
+#include "ProgramOptions.h"
+#include "exceptions.h"
+#include "timing.h"
+
+/**
+ * A micro-benchmark harness on top of TimingStatistics.
+ *
+ * Benchmarks are functions taking a State, which run the code to measure in a
+ * loop over state.keepRunning():
+ *
+ *   void insert(util::benchmark::State& state) {
+ *
+ *     std::vector<int> keys = makeKeys(state.arg());
+ *
+ *     while (state.keepRunning()) {
+ *
+ *       std::set<int> s(keys.begin(), keys.end());
+ *       util::benchmark::do_not_optimize(s);
+ *     }
+ *
+ *     state.setItemsPerIteration(keys.size());
+ *   }
+ *
+ *   UTIL_BENCHMARK(insert)->arg(1000)->arg(1000000);
+ *
+ *   UTIL_BENCHMARK_MAIN();
+ *
+ * For each registered benchmark and argument, the harness first warms up and
+ * estimates the time per iteration with growing numbers of iterations, then
+ * chooses the number of iterations such that one run takes at least
+ * --benchmark-min-time seconds, and repeats this run --benchmark-repetitions
+ * times. It reports the mean time per iteration with a 95% confidence
+ * interval, and the throughput if set with setItemsPerIteration() or
+ * setBytesPerIteration().
+ *
+ * The time per iteration of each run is also added to TimingStatistics under
+ * the name of the benchmark, such that the summary at the end of the program
+ * can be written with --timing-format and compared with timing_diff.
+ */
+
+namespace util {
+namespace benchmark {
+
+/**
+ * Prevent the compiler from optimizing away the computation of value.
+ */
+template <typename T>
+inline void do_not_optimize(const T& value) {
+
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * Prevent the compiler from assuming that memory was not modified, e.g., to
+ * keep writes that are never read.
+ */
+inline void clobber() {
+
+	asm volatile("" : : : "memory");
+}
+
+/**
+ * The interface of a benchmark function to the harness.
+ */
+class State {
+
+public:
+
+	State(uint64_t iterations, int64_t arg) :
+		_iterations(iterations),
+		_remaining(iterations),
+		_arg(arg),
+		_started(false),
+		_stopped(false),
+		_paused(false),
+		_elapsed(0),
+		_itemsPerIteration(0),
+		_bytesPerIteration(0) {}
+
+	/**
+	 * Returns true as long as the benchmark should run another iteration. The
+	 * time between the first and the last call is measured.
+	 */
+	inline bool keepRunning() {
+
+		if (__builtin_expect(_started && _remaining > 0, 1)) {
+
+			_remaining--;
+			return true;
+		}
+
+		return startOrStop();
+	}
+
+	/**
+	 * Exclude the time until resumeTiming() from the measurement, e.g., to
+	 * set up data for the next iteration.
+	 */
+	void pauseTiming();
+
+	void resumeTiming();
+
+	/**
+	 * The number of iterations of the current run.
+	 */
+	uint64_t iterations() const { return _iterations; }
+
+	/**
+	 * The argument of the current run, see Benchmark::arg().
+	 */
+	int64_t arg() const { return _arg; }
+
+	/**
+	 * Set the number of items or bytes processed in one iteration, to report
+	 * the throughput.
+	 */
+	void setItemsPerIteration(double items) { _itemsPerIteration = items; }
+
+	void setBytesPerIteration(double bytes) { _bytesPerIteration = bytes; }
+
+	/**
+	 * Report an additional value with the results of this benchmark, e.g., the
+	 * memory used. The value of the last run is shown.
+	 */
+	void setCounter(const std::string& name, double value) { _counters[name] = value; }
+
+	/**
+	 * The measured time of this run in seconds.
+	 */
+	double elapsed() const { return _elapsed; }
+
+	double itemsPerIteration() const { return _itemsPerIteration; }
+
+	double bytesPerIteration() const { return _bytesPerIteration; }
+
+	const std::map<std::string, double>& counters() const { return _counters; }
+
+	bool stopped() const { return _stopped; }
+
+private:
+
+	typedef std::chrono::steady_clock Clock;
+
+	bool startOrStop();
+
+	uint64_t _iterations;
+	uint64_t _remaining;
+	int64_t  _arg;
+
+	bool _started;
+	bool _stopped;
+	bool _paused;
+
+	Clock::time_point _begin;
+
+	double _elapsed;
+	double _itemsPerIteration;
+	double _bytesPerIteration;
+
+	std::map<std::string, double> _counters;
+};
+
+typedef std::function<void(State&)> Function;
+
+/**
+ * A registered benchmark.
+ */
+class Benchmark {
+
+public:
+
+	Benchmark(const std::string& name, Function function) :
+		_name(name),
+		_function(function) {}
+
+	/**
+	 * Add an argument to run the benchmark with. Without arguments, the
+	 * benchmark runs once with argument 0.
+	 */
+	Benchmark* arg(int64_t a) { _args.push_back(a); return this; }
+
+	Benchmark* args(const std::vector<int64_t>& as) { _args.insert(_args.end(), as.begin(), as.end()); return this; }
+
+	const std::string& getName() const { return _name; }
+
+	const std::vector<int64_t>& getArgs() const { return _args; }
+
+	void run(State& state) const { _function(state); }
+
+private:
+
+	std::string          _name;
+	Function             _function;
+	std::vector<int64_t> _args;
+};
+
+/**
+ * Register a benchmark, to be run by runBenchmarks(). Use the UTIL_BENCHMARK
+ * macros instead.
+ */
+Benchmark* registerBenchmark(const std::string& name, Function function);
+
+/**
+ * Run all registered benchmarks that match --benchmark-filter and report the
+ * results to the log channel benchmarklog. Call after
+ * util::ProgramOptions::init(), logger::LogManager::init() and
+ * TimingStatistics::init().
+ */
+void runBenchmarks();
+
+} // namespace benchmark
+} // namespace util
+
+#define UTIL_BENCHMARK_CONCAT_(a, b) a##b
+#define UTIL_BENCHMARK_CONCAT(a, b)  UTIL_BENCHMARK_CONCAT_(a, b)
+
+#define UTIL_BENCHMARK_NAMED(name, function) \
+	static ::util::benchmark::Benchmark* UTIL_BENCHMARK_CONCAT(util_benchmark_, __COUNTER__) __attribute__((unused)) = \
+			::util::benchmark::registerBenchmark(name, function)
+
+#define UTIL_BENCHMARK(function) UTIL_BENCHMARK_NAMED(#function, function)
+
+#define UTIL_BENCHMARK_MAIN() \
+	int main(int argc, char** argv) { \
+		try { \
+			util::ProgramOptions::init(argc, argv); \
+			logger::LogManager::init(); \
+			TimingStatistics::init(); \
+			util::benchmark::runBenchmarks(); \
+		} catch (boost::exception& e) { \
+			handleException(e, std::cerr); \
+			return 1; \
+		} \
+		return 0; \
+	}
+
+#endif // UTIL_BENCHMARK_H__
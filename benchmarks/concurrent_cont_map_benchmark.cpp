@@ -0,0 +1,236 @@
+/**
+ * Compares concurrent_cont_map with a cont_map and a std::unordered_map that
+ * are protected by a mutex, for different numbers of threads (the argument of
+ * each benchmark).
+ *
+ * For each container, the following operations are benchmarked with
+ * util::benchmark:
+ *
+ *   insert     all threads insert their share of the keys, in random order
+ *   lookup     all threads look up random keys of the whole key range (hits
+ *              and misses)
+ *   mixed      as lookup, but every 16th operation of each thread inserts or
+ *              overwrites a key
+ *
+ * The keys are taken with a density of 50% from the key range.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <util/benchmark.h>
+#include <util/concurrent_cont_map.hpp>
+#include <util/cont_map.hpp>
+#include <util/ProgramOptions.h>
+
+util::ProgramOption optionUniverse(
+		util::_long_name = "universe",
+		util::_description_text = "The size of the key range [0, universe) to benchmark.",
+		util::_default_value = 1000000);
+
+typedef unsigned int Key;
+typedef uint64_t     Value;
+
+/**
+ * Adaptors with a common interface for the benchmarked containers, all safe
+ * to use from several threads.
+ */
+struct ConcurrentContMap {
+
+	static const char* name() { return "concurrent_cont_map"; }
+
+	void insert(Key k, Value v) { map.insert_or_assign(k, v); }
+	bool find(Key k, Value& v) { return map.find(k, v); }
+
+	util::concurrent_cont_map<Key, Value> map;
+};
+
+struct LockedContMap {
+
+	static const char* name() { return "locked cont_map"; }
+
+	void insert(Key k, Value v) { std::lock_guard<std::mutex> lock(mutex); map[k] = v; }
+
+	bool find(Key k, Value& v) {
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (!map.count(k))
+			return false;
+		v = map.at(k);
+		return true;
+	}
+
+	std::mutex                 mutex;
+	util::cont_map<Key, Value> map;
+};
+
+struct LockedUnorderedMap {
+
+	static const char* name() { return "locked std::unordered_map"; }
+
+	void insert(Key k, Value v) { std::lock_guard<std::mutex> lock(mutex); map[k] = v; }
+
+	bool find(Key k, Value& v) {
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto i = map.find(k);
+		if (i == map.end())
+			return false;
+		v = i->second;
+		return true;
+	}
+
+	std::mutex                     mutex;
+	std::unordered_map<Key, Value> map;
+};
+
+/**
+ * The keys and lookups of all benchmarks.
+ */
+struct Data {
+
+	// keys with a density of 50%, in random order
+	std::vector<Key> keys;
+
+	// random keys of the whole key range
+	std::vector<Key> lookups;
+};
+
+const Data& getData() {
+
+	static Data d;
+
+	if (!d.keys.empty())
+		return d;
+
+	Key universe = optionUniverse.as<Key>();
+
+	std::mt19937 random(0);
+
+	std::bernoulli_distribution take(0.5);
+	for (Key k = 0; k < universe; k++)
+		if (take(random))
+			d.keys.push_back(k);
+	std::shuffle(d.keys.begin(), d.keys.end(), random);
+
+	std::uniform_int_distribution<Key> anyKey(0, universe - 1);
+	d.lookups.resize(universe);
+	for (Key& k : d.lookups)
+		k = anyKey(random);
+
+	return d;
+}
+
+/**
+ * Call f(thread, begin, end) in the given number of threads, where [begin,
+ * end) is the thread's share of n items.
+ */
+template <typename F>
+void parallel(int threads, size_t n, F f) {
+
+	std::vector<std::thread> workers;
+
+	for (int t = 0; t < threads; t++)
+		workers.emplace_back(f, t, n*t/threads, n*(t + 1)/threads);
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+template <typename Container>
+void fill(Container& container, const Data& data) {
+
+	for (Key k : data.keys)
+		container.insert(k, k);
+}
+
+template <typename Container>
+void insert(util::benchmark::State& state) {
+
+	const Data& data = getData();
+
+	while (state.keepRunning()) {
+
+		Container container;
+
+		parallel(state.arg(), data.keys.size(), [&](int, size_t begin, size_t end) {
+
+			for (size_t i = begin; i < end; i++)
+				container.insert(data.keys[i], data.keys[i]);
+		});
+
+		util::benchmark::do_not_optimize(container.map);
+	}
+
+	state.setItemsPerIteration(data.keys.size());
+}
+
+template <typename Container>
+void lookup(util::benchmark::State& state) {
+
+	const Data& data = getData();
+
+	Container container;
+	fill(container, data);
+
+	while (state.keepRunning()) {
+
+		parallel(state.arg(), data.lookups.size(), [&](int, size_t begin, size_t end) {
+
+			Value sum = 0, v;
+			for (size_t i = begin; i < end; i++)
+				if (container.find(data.lookups[i], v))
+					sum += v;
+			util::benchmark::do_not_optimize(sum);
+		});
+	}
+
+	state.setItemsPerIteration(data.lookups.size());
+}
+
+template <typename Container>
+void mixed(util::benchmark::State& state) {
+
+	const Data& data = getData();
+
+	Container container;
+	fill(container, data);
+
+	while (state.keepRunning()) {
+
+		parallel(state.arg(), data.lookups.size(), [&](int, size_t begin, size_t end) {
+
+			Value sum = 0, v;
+			for (size_t i = begin; i < end; i++) {
+
+				if (i%16 == 0)
+					container.insert(data.lookups[i], i);
+				else if (container.find(data.lookups[i], v))
+					sum += v;
+			}
+			util::benchmark::do_not_optimize(sum);
+		});
+	}
+
+	state.setItemsPerIteration(data.lookups.size());
+}
+
+const std::vector<int64_t> threads = { 1, 2, 4, 8 };
+
+#define CONTAINER_BENCHMARKS(Container) \
+	UTIL_BENCHMARK_NAMED(std::string(Container::name()) + "/insert", insert<Container>)->args(threads); \
+	UTIL_BENCHMARK_NAMED(std::string(Container::name()) + "/lookup", lookup<Container>)->args(threads); \
+	UTIL_BENCHMARK_NAMED(std::string(Container::name()) + "/mixed",  mixed<Container>)->args(threads);
+
+CONTAINER_BENCHMARKS(ConcurrentContMap)
+CONTAINER_BENCHMARKS(LockedContMap)
+CONTAINER_BENCHMARKS(LockedUnorderedMap)
+
+UTIL_BENCHMARK_MAIN()
@@ -0,0 +1,335 @@
+/**
+ * Compares cont_map with std::map, std::unordered_map and a sorted flat map
+ * for different densities of keys in a fixed key range.
+ *
+ * For each container, the following operations are benchmarked with
+ * util::benchmark, for densities of 1% to 100% (the argument of each
+ * benchmark):
+ *
+ *   insert     insert all keys in random order
+ *   lookup     look up random keys of the whole key range (hits and misses)
+ *   forward    iterate over all elements
+ *   reverse    iterate over all elements in reverse order
+ *   erase      erase every other key
+ *
+ * Additionally, the insert benchmarks report the resident memory and (for
+ * cont_map) the overhead of each container.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include <util/benchmark.h>
+#include <util/cont_map.hpp>
+#include <util/ProgramOptions.h>
+
+util::ProgramOption optionUniverse(
+		util::_long_name = "universe",
+		util::_description_text = "The size of the key range [0, universe) to benchmark.",
+		util::_default_value = 1000000);
+
+typedef unsigned int Key;
+typedef uint64_t     Value;
+
+/**
+ * Adaptors with a common interface for the benchmarked containers.
+ */
+struct ContMap {
+
+	static const char* name() { return "cont_map"; }
+
+	void insert(Key k, Value v) { map[k] = v; }
+	bool find(Key k, Value& v) { if (!map.count(k)) return false; v = map.at(k); return true; }
+	void finalize() {}
+
+	template <typename F> void forward(F f) { for (auto i = map.begin(); i != map.end(); ++i) f(i->second); }
+	template <typename F> void reverse(F f) { for (auto i = map.rbegin(); i != map.rend(); ++i) f(i->second); }
+
+	void erase(const std::vector<Key>& keys) { for (Key k : keys) map.erase(k); }
+
+	double overhead() { return map.overhead(); }
+
+	util::cont_map<Key, Value> map;
+};
+
+struct StdMap {
+
+	static const char* name() { return "std::map"; }
+
+	void insert(Key k, Value v) { map[k] = v; }
+	bool find(Key k, Value& v) { auto i = map.find(k); if (i == map.end()) return false; v = i->second; return true; }
+	void finalize() {}
+
+	template <typename F> void forward(F f) { for (auto i = map.begin(); i != map.end(); ++i) f(i->second); }
+	template <typename F> void reverse(F f) { for (auto i = map.rbegin(); i != map.rend(); ++i) f(i->second); }
+
+	void erase(const std::vector<Key>& keys) { for (Key k : keys) map.erase(k); }
+
+	double overhead() { return 0; }
+
+	std::map<Key, Value> map;
+};
+
+struct StdUnorderedMap {
+
+	static const char* name() { return "std::unordered_map"; }
+
+	void insert(Key k, Value v) { map[k] = v; }
+	bool find(Key k, Value& v) { auto i = map.find(k); if (i == map.end()) return false; v = i->second; return true; }
+	void finalize() {}
+
+	// unordered, reverse iteration is not supported by the container
+	template <typename F> void forward(F f) { for (auto i = map.begin(); i != map.end(); ++i) f(i->second); }
+	template <typename F> void reverse(F f) { forward(f); }
+
+	void erase(const std::vector<Key>& keys) { for (Key k : keys) map.erase(k); }
+
+	double overhead() { return 0; }
+
+	std::unordered_map<Key, Value> map;
+};
+
+/**
+ * A sorted vector of key-value pairs. Insertion appends, finalize() sorts, and
+ * erase removes a batch of keys in one pass, which is how flat maps are used
+ * in practice.
+ */
+struct FlatMap {
+
+	typedef std::pair<Key, Value> Element;
+
+	static const char* name() { return "flat_map"; }
+
+	void insert(Key k, Value v) { map.push_back(Element(k, v)); }
+
+	bool find(Key k, Value& v) {
+
+		auto i = std::lower_bound(map.begin(), map.end(), Element(k, 0), less);
+		if (i == map.end() || i->first != k)
+			return false;
+		v = i->second;
+		return true;
+	}
+
+	void finalize() { std::sort(map.begin(), map.end(), less); }
+
+	template <typename F> void forward(F f) { for (auto i = map.begin(); i != map.end(); ++i) f(i->second); }
+	template <typename F> void reverse(F f) { for (auto i = map.rbegin(); i != map.rend(); ++i) f(i->second); }
+
+	void erase(const std::vector<Key>& keys) {
+
+		std::vector<Key> sorted(keys);
+		std::sort(sorted.begin(), sorted.end());
+
+		auto next = sorted.begin();
+		map.erase(
+				std::remove_if(map.begin(), map.end(), [&](const Element& e) {
+						while (next != sorted.end() && *next < e.first)
+							++next;
+						return next != sorted.end() && *next == e.first;
+				}),
+				map.end());
+	}
+
+	double overhead() { return 0; }
+
+	static bool less(const Element& a, const Element& b) { return a.first < b.first; }
+
+	std::vector<Element> map;
+};
+
+/**
+ * The resident set size of this process in bytes.
+ */
+size_t residentMemory() {
+
+	size_t pages, resident;
+
+	std::ifstream statm("/proc/self/statm");
+	statm >> pages >> resident;
+
+	return resident*sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * The keys and lookups for one density.
+ */
+struct Data {
+
+	// keys with the given density, in random order
+	std::vector<Key> keys;
+
+	// every other key
+	std::vector<Key> toErase;
+
+	// random keys of the whole key range
+	std::vector<Key> lookups;
+};
+
+const Data& getData(int percent) {
+
+	static std::map<int, Data> data;
+
+	std::map<int, Data>::iterator i = data.find(percent);
+	if (i != data.end())
+		return i->second;
+
+	Key universe = optionUniverse.as<Key>();
+
+	std::mt19937 random(percent);
+	Data& d = data[percent];
+
+	std::bernoulli_distribution take(percent/100.0);
+	for (Key k = 0; k < universe; k++)
+		if (take(random))
+			d.keys.push_back(k);
+	std::shuffle(d.keys.begin(), d.keys.end(), random);
+
+	for (size_t k = 0; k < d.keys.size(); k += 2)
+		d.toErase.push_back(d.keys[k]);
+
+	std::uniform_int_distribution<Key> anyKey(0, universe - 1);
+	d.lookups.resize(universe);
+	for (Key& k : d.lookups)
+		k = anyKey(random);
+
+	return d;
+}
+
+template <typename Container>
+void fill(Container& container, const Data& data) {
+
+	for (Key k : data.keys)
+		container.insert(k, k);
+	container.finalize();
+}
+
+template <typename Container>
+void insert(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	while (state.keepRunning()) {
+
+		Container container;
+		fill(container, data);
+		util::benchmark::do_not_optimize(container.map);
+	}
+
+	state.setItemsPerIteration(data.keys.size());
+
+	// memory, not timed
+	malloc_trim(0);
+	size_t before = residentMemory();
+
+	Container container;
+	fill(container, data);
+
+	// the resident memory can also shrink
+	size_t after = residentMemory();
+	state.setCounter("KiB", (after > before ? after - before : 0)/1024);
+	if (container.overhead() > 0)
+		state.setCounter("overhead", container.overhead());
+}
+
+template <typename Container>
+void lookup(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	Container container;
+	fill(container, data);
+
+	while (state.keepRunning()) {
+
+		Value sum = 0, v;
+		for (Key k : data.lookups)
+			if (container.find(k, v))
+				sum += v;
+		util::benchmark::do_not_optimize(sum);
+	}
+
+	state.setItemsPerIteration(data.lookups.size());
+}
+
+template <typename Container>
+void forward(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	Container container;
+	fill(container, data);
+
+	while (state.keepRunning()) {
+
+		Value sum = 0;
+		container.forward([&sum](Value v) { sum += v; });
+		util::benchmark::do_not_optimize(sum);
+	}
+
+	state.setItemsPerIteration(data.keys.size());
+}
+
+template <typename Container>
+void reverse(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	Container container;
+	fill(container, data);
+
+	while (state.keepRunning()) {
+
+		Value sum = 0;
+		container.reverse([&sum](Value v) { sum += v; });
+		util::benchmark::do_not_optimize(sum);
+	}
+
+	state.setItemsPerIteration(data.keys.size());
+}
+
+template <typename Container>
+void erase(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	Container full;
+	fill(full, data);
+
+	while (state.keepRunning()) {
+
+		state.pauseTiming();
+		Container container(full);
+		state.resumeTiming();
+
+		container.erase(data.toErase);
+		util::benchmark::do_not_optimize(container.map);
+	}
+
+	state.setItemsPerIteration(data.toErase.size());
+}
+
+const std::vector<int64_t> densities = { 1, 5, 10, 25, 50, 75, 100 };
+
+#define CONTAINER_BENCHMARKS(Container) \
+	UTIL_BENCHMARK_NAMED(std::string(Container::name()) + "/insert",  insert<Container>)->args(densities); \
+	UTIL_BENCHMARK_NAMED(std::string(Container::name()) + "/lookup",  lookup<Container>)->args(densities); \
+	UTIL_BENCHMARK_NAMED(std::string(Container::name()) + "/forward", forward<Container>)->args(densities); \
+	UTIL_BENCHMARK_NAMED(std::string(Container::name()) + "/reverse", reverse<Container>)->args(densities); \
+	UTIL_BENCHMARK_NAMED(std::string(Container::name()) + "/erase",   erase<Container>)->args(densities);
+
+CONTAINER_BENCHMARKS(ContMap)
+CONTAINER_BENCHMARKS(StdMap)
+CONTAINER_BENCHMARKS(StdUnorderedMap)
+CONTAINER_BENCHMARKS(FlatMap)
+
+UTIL_BENCHMARK_MAIN()
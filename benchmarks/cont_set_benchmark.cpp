@@ -0,0 +1,278 @@
+/**
+ * Compares cont_set with std::set and std::unordered_set for different
+ * densities of keys in a fixed key range.
+ *
+ * For each container, the following operations are benchmarked with
+ * util::benchmark, for densities of 1% to 100% (the argument of each
+ * benchmark):
+ *
+ *   insert     insert all keys in random order
+ *   lookup     look up random keys of the whole key range (hits and misses)
+ *   forward    iterate over all keys
+ *   union      add a second set of the same density
+ *   intersect  remove all keys that are not in a second set of the same
+ *              density
+ *
+ * Additionally, the insert benchmarks report the overhead of cont_set.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+#include <util/benchmark.h>
+#include <util/cont_set.hpp>
+#include <util/ProgramOptions.h>
+
+util::ProgramOption optionUniverse(
+		util::_long_name = "universe",
+		util::_description_text = "The size of the key range [0, universe) to benchmark.",
+		util::_default_value = 1000000);
+
+typedef unsigned int Key;
+
+/**
+ * Adaptors with a common interface for the benchmarked containers.
+ */
+struct ContSet {
+
+	static const char* name() { return "cont_set"; }
+
+	void insert(Key k) { set.insert(k); }
+	bool find(Key k) { return set.count(k); }
+
+	template <typename F> void forward(F f) { for (auto i = set.begin(); i != set.end(); ++i) f(*i); }
+
+	// word-wise on the bit vectors
+	void unite(const ContSet& other) { set |= other.set; }
+	void intersect(const ContSet& other) { set &= other.set; }
+
+	double overhead() { return set.overhead(); }
+
+	util::cont_set<Key> set;
+};
+
+struct StdSet {
+
+	static const char* name() { return "std::set"; }
+
+	void insert(Key k) { set.insert(k); }
+	bool find(Key k) { return set.count(k); }
+
+	template <typename F> void forward(F f) { for (auto i = set.begin(); i != set.end(); ++i) f(*i); }
+
+	void unite(const StdSet& other) { set.insert(other.set.begin(), other.set.end()); }
+
+	void intersect(const StdSet& other) {
+
+		for (auto i = set.begin(); i != set.end();)
+			if (other.set.count(*i))
+				++i;
+			else
+				i = set.erase(i);
+	}
+
+	double overhead() { return 0; }
+
+	std::set<Key> set;
+};
+
+struct StdUnorderedSet {
+
+	static const char* name() { return "std::unordered_set"; }
+
+	void insert(Key k) { set.insert(k); }
+	bool find(Key k) { return set.count(k); }
+
+	// unordered
+	template <typename F> void forward(F f) { for (auto i = set.begin(); i != set.end(); ++i) f(*i); }
+
+	void unite(const StdUnorderedSet& other) { set.insert(other.set.begin(), other.set.end()); }
+
+	void intersect(const StdUnorderedSet& other) {
+
+		for (auto i = set.begin(); i != set.end();)
+			if (other.set.count(*i))
+				++i;
+			else
+				i = set.erase(i);
+	}
+
+	double overhead() { return 0; }
+
+	std::unordered_set<Key> set;
+};
+
+/**
+ * The keys and lookups for one density.
+ */
+struct Data {
+
+	// keys with the given density, in random order
+	std::vector<Key> keys;
+
+	// another set of keys with the same density, for union and intersection
+	std::vector<Key> otherKeys;
+
+	// random keys of the whole key range
+	std::vector<Key> lookups;
+};
+
+const Data& getData(int percent) {
+
+	static std::map<int, Data> data;
+
+	std::map<int, Data>::iterator i = data.find(percent);
+	if (i != data.end())
+		return i->second;
+
+	Key universe = optionUniverse.as<Key>();
+
+	std::mt19937 random(percent);
+	Data& d = data[percent];
+
+	std::bernoulli_distribution take(percent/100.0);
+	for (Key k = 0; k < universe; k++) {
+
+		if (take(random))
+			d.keys.push_back(k);
+		if (take(random))
+			d.otherKeys.push_back(k);
+	}
+	std::shuffle(d.keys.begin(), d.keys.end(), random);
+	std::shuffle(d.otherKeys.begin(), d.otherKeys.end(), random);
+
+	std::uniform_int_distribution<Key> anyKey(0, universe - 1);
+	d.lookups.resize(universe);
+	for (Key& k : d.lookups)
+		k = anyKey(random);
+
+	return d;
+}
+
+template <typename Container>
+void fill(Container& container, const std::vector<Key>& keys) {
+
+	for (Key k : keys)
+		container.insert(k);
+}
+
+template <typename Container>
+void insert(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	while (state.keepRunning()) {
+
+		Container container;
+		fill(container, data.keys);
+		util::benchmark::do_not_optimize(container.set);
+	}
+
+	state.setItemsPerIteration(data.keys.size());
+
+	Container container;
+	fill(container, data.keys);
+	if (container.overhead() > 0)
+		state.setCounter("overhead", container.overhead());
+}
+
+template <typename Container>
+void lookup(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	Container container;
+	fill(container, data.keys);
+
+	while (state.keepRunning()) {
+
+		uint64_t hits = 0;
+		for (Key k : data.lookups)
+			hits += container.find(k);
+		util::benchmark::do_not_optimize(hits);
+	}
+
+	state.setItemsPerIteration(data.lookups.size());
+}
+
+template <typename Container>
+void forward(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	Container container;
+	fill(container, data.keys);
+
+	while (state.keepRunning()) {
+
+		uint64_t sum = 0;
+		container.forward([&sum](Key k) { sum += k; });
+		util::benchmark::do_not_optimize(sum);
+	}
+
+	state.setItemsPerIteration(data.keys.size());
+}
+
+template <typename Container>
+void unite(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	Container full, other;
+	fill(full, data.keys);
+	fill(other, data.otherKeys);
+
+	while (state.keepRunning()) {
+
+		state.pauseTiming();
+		Container container(full);
+		state.resumeTiming();
+
+		container.unite(other);
+		util::benchmark::do_not_optimize(container.set);
+	}
+
+	state.setItemsPerIteration(data.otherKeys.size());
+}
+
+template <typename Container>
+void intersect(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	Container full, other;
+	fill(full, data.keys);
+	fill(other, data.otherKeys);
+
+	while (state.keepRunning()) {
+
+		state.pauseTiming();
+		Container container(full);
+		state.resumeTiming();
+
+		container.intersect(other);
+		util::benchmark::do_not_optimize(container.set);
+	}
+
+	state.setItemsPerIteration(data.keys.size());
+}
+
+const std::vector<int64_t> densities = { 1, 5, 10, 25, 50, 75, 100 };
+
+#define CONTAINER_BENCHMARKS(Container) \
+	UTIL_BENCHMARK_NAMED(std::string(Container::name()) + "/insert",    insert<Container>)->args(densities); \
+	UTIL_BENCHMARK_NAMED(std::string(Container::name()) + "/lookup",    lookup<Container>)->args(densities); \
+	UTIL_BENCHMARK_NAMED(std::string(Container::name()) + "/forward",   forward<Container>)->args(densities); \
+	UTIL_BENCHMARK_NAMED(std::string(Container::name()) + "/union",     unite<Container>)->args(densities); \
+	UTIL_BENCHMARK_NAMED(std::string(Container::name()) + "/intersect", intersect<Container>)->args(densities);
+
+CONTAINER_BENCHMARKS(ContSet)
+CONTAINER_BENCHMARKS(StdSet)
+CONTAINER_BENCHMARKS(StdUnorderedSet)
+
+UTIL_BENCHMARK_MAIN()
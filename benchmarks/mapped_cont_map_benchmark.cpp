@@ -0,0 +1,187 @@
+/**
+ * Compares a mapped_cont_map with the cont_map it was written from, for
+ * different densities of keys in a fixed key range.
+ *
+ * The following operations are benchmarked with util::benchmark, for
+ * densities of 1% to 100% (the argument of each benchmark):
+ *
+ *   write      write the cont_map to a file with write_cont_map
+ *   open       open and map the file
+ *   lookup     look up random keys of the whole key range (hits and misses),
+ *              in the mapped file and in the cont_map
+ *   forward    iterate over all elements, in the mapped file and in the
+ *              cont_map
+ *
+ * The file is written to --file and stays in the page cache between runs, so
+ * open and the first lookups do not include reading from the disk.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <util/benchmark.h>
+#include <util/cont_map.hpp>
+#include <util/mapped_cont_map.hpp>
+#include <util/ProgramOptions.h>
+
+util::ProgramOption optionUniverse(
+		util::_long_name = "universe",
+		util::_description_text = "The size of the key range [0, universe) to benchmark.",
+		util::_default_value = 1000000);
+
+util::ProgramOption optionFile(
+		util::_long_name = "file",
+		util::_description_text = "The file to write the cont_maps to. It is removed at the end.",
+		util::_default_value = "mapped_cont_map_benchmark.dat");
+
+typedef unsigned int Key;
+typedef uint64_t     Value;
+
+/**
+ * The keys and lookups for one density.
+ */
+struct Data {
+
+	util::cont_map<Key, Value> map;
+
+	// random keys of the whole key range
+	std::vector<Key> lookups;
+};
+
+Data& getData(int percent) {
+
+	static std::map<int, Data> data;
+
+	std::map<int, Data>::iterator i = data.find(percent);
+	if (i != data.end())
+		return i->second;
+
+	Key universe = optionUniverse.as<Key>();
+
+	std::mt19937 random(percent);
+	Data& d = data[percent];
+
+	std::bernoulli_distribution take(percent/100.0);
+	for (Key k = 0; k < universe; k++)
+		if (take(random))
+			d.map[k] = k;
+
+	std::uniform_int_distribution<Key> anyKey(0, universe - 1);
+	d.lookups.resize(universe);
+	for (Key& k : d.lookups)
+		k = anyKey(random);
+
+	return d;
+}
+
+/**
+ * Write the cont_map of the given density to the file, and remove it again at
+ * the end of the scope.
+ */
+struct File {
+
+	File(int percent) : name(optionFile.as<std::string>()) { util::write_cont_map(getData(percent).map, name); }
+
+	~File() { std::remove(name.c_str()); }
+
+	std::string name;
+};
+
+void writeFile(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+	std::string name = optionFile;
+
+	while (state.keepRunning())
+		util::write_cont_map(data.map, name);
+
+	std::remove(name.c_str());
+
+	state.setItemsPerIteration(data.map.size());
+	state.setBytesPerIteration(data.map.num_slots()*sizeof(util::cont_map<Key, Value>::value_type));
+}
+
+void openFile(util::benchmark::State& state) {
+
+	File file(state.arg());
+
+	while (state.keepRunning()) {
+
+		util::mapped_cont_map<Key, Value> mapped(file.name);
+		util::benchmark::do_not_optimize(mapped.size());
+	}
+}
+
+template <typename Map>
+void lookup(const Map& map, const Data& data, util::benchmark::State& state) {
+
+	while (state.keepRunning()) {
+
+		Value sum = 0;
+		for (Key k : data.lookups)
+			if (map.count(k))
+				sum += map.at(k);
+		util::benchmark::do_not_optimize(sum);
+	}
+
+	state.setItemsPerIteration(data.lookups.size());
+}
+
+template <typename Map>
+void forward(Map& map, const Data& data, util::benchmark::State& state) {
+
+	while (state.keepRunning()) {
+
+		Value sum = 0;
+		for (auto i = map.begin(); i != map.end(); ++i)
+			sum += i->second;
+		util::benchmark::do_not_optimize(sum);
+	}
+
+	state.setItemsPerIteration(data.map.size());
+}
+
+void mappedLookup(util::benchmark::State& state) {
+
+	File file(state.arg());
+	util::mapped_cont_map<Key, Value> mapped(file.name);
+
+	lookup(mapped, getData(state.arg()), state);
+}
+
+void mappedForward(util::benchmark::State& state) {
+
+	File file(state.arg());
+	util::mapped_cont_map<Key, Value> mapped(file.name);
+
+	forward(mapped, getData(state.arg()), state);
+}
+
+void contMapLookup(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	lookup(data.map, data, state);
+}
+
+void contMapForward(util::benchmark::State& state) {
+
+	Data& data = getData(state.arg());
+
+	forward(data.map, data, state);
+}
+
+const std::vector<int64_t> densities = { 1, 5, 10, 25, 50, 75, 100 };
+
+UTIL_BENCHMARK_NAMED("mapped_cont_map/write",   writeFile)->args(densities);
+UTIL_BENCHMARK_NAMED("mapped_cont_map/open",    openFile)->args(densities);
+UTIL_BENCHMARK_NAMED("mapped_cont_map/lookup",  mappedLookup)->args(densities);
+UTIL_BENCHMARK_NAMED("mapped_cont_map/forward", mappedForward)->args(densities);
+UTIL_BENCHMARK_NAMED("cont_map/lookup",         contMapLookup)->args(densities);
+UTIL_BENCHMARK_NAMED("cont_map/forward",        contMapForward)->args(densities);
+
+UTIL_BENCHMARK_MAIN()
@@ -0,0 +1,197 @@
+/**
+ * Benchmarks the operations of rank_select for bit vectors of different
+ * sizes (the argument of each benchmark), with half of the bits set:
+ *
+ *   set        set the bits in random order
+ *   reset      reset every other set bit
+ *   rank       the number of set bits before random positions
+ *   select     the positions of random set bits
+ *
+ * For comparison, scan/rank counts the set bits before random positions by
+ * summing the popcount of all words before them, which is what rank_select
+ * avoids with its Fenwick tree.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <util/benchmark.h>
+#include <util/rank_select.hpp>
+#include <util/ProgramOptions.h>
+
+util::ProgramOption optionQueries(
+		util::_long_name = "queries",
+		util::_description_text = "The number of random rank and select queries per iteration.",
+		util::_default_value = 100000);
+
+typedef util::rank_select::size_type size_type;
+
+/**
+ * The bits and queries for one size.
+ */
+struct Data {
+
+	// the positions of the set bits, in random order
+	std::vector<size_type> ones;
+
+	// every other set bit
+	std::vector<size_type> toReset;
+
+	// random positions, for rank
+	std::vector<size_type> positions;
+
+	// random numbers of set bits, for select
+	std::vector<size_type> nths;
+};
+
+const Data& getData(size_type size) {
+
+	static std::map<size_type, Data> data;
+
+	std::map<size_type, Data>::iterator i = data.find(size);
+	if (i != data.end())
+		return i->second;
+
+	size_type queries = optionQueries.as<size_type>();
+
+	std::mt19937 random(size);
+	Data& d = data[size];
+
+	std::bernoulli_distribution take(0.5);
+	for (size_type b = 0; b < size; b++)
+		if (take(random))
+			d.ones.push_back(b);
+	std::shuffle(d.ones.begin(), d.ones.end(), random);
+
+	for (size_t b = 0; b < d.ones.size(); b += 2)
+		d.toReset.push_back(d.ones[b]);
+
+	std::uniform_int_distribution<size_type> anyPosition(0, size - 1);
+	d.positions.resize(queries);
+	for (size_type& p : d.positions)
+		p = anyPosition(random);
+
+	std::uniform_int_distribution<size_type> anyNth(0, d.ones.size() - 1);
+	d.nths.resize(queries);
+	for (size_type& n : d.nths)
+		n = anyNth(random);
+
+	return d;
+}
+
+void fill(util::rank_select& bits, size_type size, const Data& data) {
+
+	bits.resize(size);
+	for (size_type b : data.ones)
+		bits.set(b);
+}
+
+void setBits(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	while (state.keepRunning()) {
+
+		util::rank_select bits;
+		fill(bits, state.arg(), data);
+		util::benchmark::do_not_optimize(bits.count());
+	}
+
+	state.setItemsPerIteration(data.ones.size());
+}
+
+void resetBits(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	util::rank_select full;
+	fill(full, state.arg(), data);
+
+	while (state.keepRunning()) {
+
+		state.pauseTiming();
+		util::rank_select bits(full);
+		state.resumeTiming();
+
+		for (size_type b : data.toReset)
+			bits.reset(b);
+		util::benchmark::do_not_optimize(bits.count());
+	}
+
+	state.setItemsPerIteration(data.toReset.size());
+}
+
+void rankQueries(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	util::rank_select bits;
+	fill(bits, state.arg(), data);
+
+	while (state.keepRunning()) {
+
+		size_type sum = 0;
+		for (size_type p : data.positions)
+			sum += bits.rank(p);
+		util::benchmark::do_not_optimize(sum);
+	}
+
+	state.setItemsPerIteration(data.positions.size());
+}
+
+void selectQueries(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	util::rank_select bits;
+	fill(bits, state.arg(), data);
+
+	while (state.keepRunning()) {
+
+		size_type sum = 0;
+		for (size_type n : data.nths)
+			sum += bits.select(n);
+		util::benchmark::do_not_optimize(sum);
+	}
+
+	state.setItemsPerIteration(data.nths.size());
+}
+
+void scanRank(util::benchmark::State& state) {
+
+	const Data& data = getData(state.arg());
+
+	std::vector<uint64_t> words((state.arg() + 63)/64, 0);
+	for (size_type b : data.ones)
+		words[b/64] |= uint64_t(1) << (b%64);
+
+	while (state.keepRunning()) {
+
+		size_type sum = 0;
+		for (size_type p : data.positions) {
+
+			for (size_type w = 0; w < p/64; w++)
+				sum += __builtin_popcountll(words[w]);
+			if (p%64)
+				sum += __builtin_popcountll(words[p/64] & ((uint64_t(1) << (p%64)) - 1));
+		}
+		util::benchmark::do_not_optimize(sum);
+	}
+
+	state.setItemsPerIteration(data.positions.size());
+}
+
+const std::vector<int64_t> sizes = { 1 << 10, 1 << 16, 1 << 20, 1 << 24 };
+
+UTIL_BENCHMARK_NAMED("rank_select/set",    setBits)->args(sizes);
+UTIL_BENCHMARK_NAMED("rank_select/reset",  resetBits)->args(sizes);
+UTIL_BENCHMARK_NAMED("rank_select/rank",   rankQueries)->args(sizes);
+UTIL_BENCHMARK_NAMED("rank_select/select", selectQueries)->args(sizes);
+
+// quadratic, only for the smaller sizes
+UTIL_BENCHMARK_NAMED("scan/rank", scanRank)->arg(1 << 10)->arg(1 << 16);
+
+UTIL_BENCHMARK_MAIN()
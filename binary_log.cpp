@@ -0,0 +1,173 @@
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <vector>
+#include "binary_log.h"
+#include "exceptions.h"
+
+namespace logger {
+
+const uint64_t BinaryLog::Magic;
+const uint32_t BinaryLog::Version;
+
+namespace {
+
+// the size of the buffer of each thread
+const size_t BufferSize = 64*1024;
+
+std::mutex        fileMutex;
+std::ofstream     file;
+std::atomic<bool> opened(false);
+
+uint32_t              nextId = 1;
+std::atomic<uint32_t> nextThread(0);
+
+template <typename T>
+void write(const T& t) {
+
+	file.write(reinterpret_cast<const char*>(&t), sizeof(T));
+}
+
+void writeString(const std::string& s) {
+
+	write(uint32_t(s.size()));
+	file.write(s.data(), s.size());
+}
+
+// the messages of one thread, written to the file as one chunk
+struct ThreadBuffer {
+
+	ThreadBuffer() :
+		data(BufferSize),
+		size(0),
+		thread(nextThread++) {}
+
+	~ThreadBuffer() {
+
+		writeChunk();
+	}
+
+	void writeChunk() {
+
+		if (size == 0)
+			return;
+
+		std::lock_guard<std::mutex> lock(fileMutex);
+
+		if (file.is_open()) {
+
+			write(uint8_t(BinaryLog::ChunkRecord));
+			write(thread);
+			write(FlightRecorder::timestamp());
+			write(FlightRecorder::monotonicTime());
+			write(uint32_t(size));
+			file.write(&data[0], size);
+		}
+
+		size = 0;
+	}
+
+	std::vector<char> data;
+	size_t            size;
+	uint32_t          thread;
+};
+
+ThreadBuffer& threadBuffer() {
+
+	static thread_local ThreadBuffer buffer;
+
+	return buffer;
+}
+
+} // anonymous namespace
+
+void
+BinaryLog::open(const std::string& filename) {
+
+	std::lock_guard<std::mutex> lock(fileMutex);
+
+	if (file.is_open())
+		file.close();
+
+	file.open(filename.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+
+	if (!file.is_open())
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				"[BinaryLog] can not open " << filename);
+
+	uint64_t realTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+
+	write(Magic);
+	write(Version);
+	write(FlightRecorder::timestamp());
+	write(FlightRecorder::monotonicTime());
+	write(realTime);
+
+	opened.store(true, std::memory_order_release);
+}
+
+bool
+BinaryLog::isOpen() {
+
+	return opened.load(std::memory_order_acquire);
+}
+
+void
+BinaryLog::flush() {
+
+	threadBuffer().writeChunk();
+
+	std::lock_guard<std::mutex> lock(fileMutex);
+	file.flush();
+}
+
+uint32_t
+BinaryLog::define(Callsite& site, LogChannel& channel, const char* types) {
+
+	std::lock_guard<std::mutex> lock(fileMutex);
+
+	// another thread was faster
+	uint32_t id = site.id.load(std::memory_order_acquire);
+	if (id)
+		return id;
+
+	id = nextId++;
+
+	write(uint8_t(CallsiteRecord));
+	write(id);
+	write(uint8_t(site.level));
+	writeString(channel.getName());
+	writeString(channel.getPrefix());
+	writeString(site.file);
+	write(uint32_t(site.line));
+	writeString(types);
+	writeString(site.format);
+
+	site.id.store(id, std::memory_order_release);
+
+	return id;
+}
+
+char*
+BinaryLog::reserve(size_t size) {
+
+	ThreadBuffer& buffer = threadBuffer();
+
+	if (buffer.size + size > buffer.data.size()) {
+
+		buffer.writeChunk();
+
+		// a message larger than the buffer
+		if (size > buffer.data.size())
+			buffer.data.resize(size);
+	}
+
+	char* p = &buffer.data[buffer.size];
+	buffer.size += size;
+
+	return p;
+}
+
+} // namespace logger
@@ -0,0 +1,252 @@
+#ifndef UTIL_BINARY_LOG_H__
+#define UTIL_BINARY_LOG_H__
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include "Logger.h"
+#include "flight_recorder.h"
+
+/**
+ * Log a message with "{}" placeholders for the arguments, e.g.,
+ *
+ *   LOG_BINARY(solverlog, logger::Debug, "iteration {}: energy {}", i, e);
+ *
+ * If the channel writes binary (see --log-binary), only the id of the format
+ * string, a time stamp, and the raw bytes of the arguments are appended to a
+ * buffer of the current thread. The text is rendered offline with the tool
+ * log_decode. Otherwise, the message is formatted and written like any other
+ * log message. Arguments can be integers, floating point numbers, bool, char,
+ * strings, and pointers.
+ */
+#define LOG_BINARY(channel, level, format, ...) \
+	do { \
+		if (logger::MaxLogLevel<decltype(channel)>::value >= level && channel.getLogLevel() >= level) { \
+			static logger::BinaryLog::Callsite util_log_callsite_ = { format, __FILE__, __LINE__, level, {0} }; \
+			logger::BinaryLog::log(util_log_callsite_, channel, ##__VA_ARGS__); \
+		} \
+	} while (false)
+
+namespace logger {
+
+/**
+ * Writes the messages of LOG_BINARY for channels in binary mode to a file.
+ *
+ * The file starts with a header, followed by records of two kinds: the
+ * definition of a callsite (written once, when a callsite logs for the first
+ * time), and a chunk of messages of one thread (written when the 64kB buffer
+ * of the thread is full, at flush(), or when the thread ends). The header and
+ * each chunk contain a pair of time stamp and monotonic clock, from which the
+ * decoder converts the time stamps of the messages. All numbers are in the
+ * byte order of the writing machine, see log_decode for the layout.
+ */
+class BinaryLog {
+
+public:
+
+	/**
+	 * The types of arguments, as stored in the callsite definitions.
+	 */
+	enum ArgumentType {
+
+		Signed   = 'i', // int64_t
+		Unsigned = 'u', // uint64_t
+		Double   = 'd', // double
+		Bool     = 'b', // uint8_t
+		Char     = 'c', // char
+		String   = 's', // uint32_t length, followed by the characters
+		Pointer  = 'p'  // uint64_t
+	};
+
+	enum RecordType {
+
+		CallsiteRecord = 1,
+		ChunkRecord    = 2
+	};
+
+	// "UTILBLOG"
+	static const uint64_t Magic   = 0x474f4c424c495455ULL;
+	static const uint32_t Version = 1;
+
+	/**
+	 * The static description of one LOG_BINARY statement.
+	 */
+	struct Callsite {
+
+		const char* format;
+		const char* file;
+		int         line;
+		LogLevel    level;
+
+		// assigned on the first call, 0 before
+		std::atomic<uint32_t> id;
+	};
+
+	/**
+	 * Open the file for binary channels. Called by LogManager::init() for
+	 * --log-binary-file.
+	 */
+	static void open(const std::string& filename);
+
+	static bool isOpen();
+
+	/**
+	 * Write the buffered messages of the current thread to the file.
+	 */
+	static void flush();
+
+	template <typename... Args>
+	static void log(Callsite& site, LogChannel& channel, const Args&... args) {
+
+		if (!channel.isBinary() || !isOpen()) {
+
+			Logger& out = channel(site.level);
+			formatText(out, site.format, args...);
+			out << std::endl;
+
+			return;
+		}
+
+		uint32_t id = site.id.load(std::memory_order_acquire);
+		if (!id) {
+
+			const char types[] = { argumentType(args)..., 0 };
+			id = define(site, channel, types);
+		}
+
+		size_t size = sizeof(uint32_t) + sizeof(uint64_t) + encodedSize(args...);
+
+		char* p = reserve(size);
+
+		put(p, id);
+		put(p, FlightRecorder::timestamp());
+		encode(p, args...);
+	}
+
+private:
+
+	// the argument types
+
+	template <typename T>
+	static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, char>::type
+	argumentType(const T&) { return Signed; }
+
+	template <typename T>
+	static typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, char>::type
+	argumentType(const T&) { return Unsigned; }
+
+	template <typename T>
+	static typename std::enable_if<std::is_enum<T>::value, char>::type
+	argumentType(const T&) { return Signed; }
+
+	static char argumentType(bool)               { return Bool; }
+	static char argumentType(char)               { return Char; }
+	static char argumentType(float)              { return Double; }
+	static char argumentType(double)             { return Double; }
+	static char argumentType(const char*)        { return String; }
+	static char argumentType(char*)              { return String; }
+	static char argumentType(const std::string&) { return String; }
+	static char argumentType(const void*)        { return Pointer; }
+
+	// the encoded sizes, the overloads have to match the ones of argumentType
+	// and encodeArgument (e.g., for char*, which the template would take)
+
+	static size_t encodedSize() { return 0; }
+
+	template <typename T, typename... Rest>
+	static size_t encodedSize(const T& t, const Rest&... rest) { return size(t) + encodedSize(rest...); }
+
+	template <typename T>
+	static size_t size(const T&)                 { return sizeof(uint64_t); }
+	static size_t size(bool)                     { return 1; }
+	static size_t size(char)                     { return 1; }
+	static size_t size(const char* s)            { return sizeof(uint32_t) + std::strlen(s); }
+	static size_t size(char* s)                  { return sizeof(uint32_t) + std::strlen(s); }
+	static size_t size(const std::string& s)     { return sizeof(uint32_t) + s.size(); }
+
+	// the encoding
+
+	static void encode(char*&) {}
+
+	template <typename T, typename... Rest>
+	static void encode(char*& p, const T& t, const Rest&... rest) {
+
+		encodeArgument(p, t);
+		encode(p, rest...);
+	}
+
+	template <typename T>
+	static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+	encodeArgument(char*& p, const T& t) { put(p, int64_t(t)); }
+
+	template <typename T>
+	static typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type
+	encodeArgument(char*& p, const T& t) { put(p, uint64_t(t)); }
+
+	template <typename T>
+	static typename std::enable_if<std::is_enum<T>::value>::type
+	encodeArgument(char*& p, const T& t) { put(p, int64_t(t)); }
+
+	static void encodeArgument(char*& p, bool b)               { put(p, uint8_t(b)); }
+	static void encodeArgument(char*& p, char c)               { put(p, c); }
+	static void encodeArgument(char*& p, float f)              { put(p, double(f)); }
+	static void encodeArgument(char*& p, double d)             { put(p, d); }
+	static void encodeArgument(char*& p, const char* s)        { putString(p, s, std::strlen(s)); }
+	static void encodeArgument(char*& p, char* s)              { putString(p, s, std::strlen(s)); }
+	static void encodeArgument(char*& p, const std::string& s) { putString(p, s.data(), s.size()); }
+	static void encodeArgument(char*& p, const void* q)        { put(p, uint64_t(reinterpret_cast<uintptr_t>(q))); }
+
+	template <typename T>
+	static void put(char*& p, const T& t) {
+
+		std::memcpy(p, &t, sizeof(T));
+		p += sizeof(T);
+	}
+
+	static void putString(char*& p, const char* s, size_t length) {
+
+		put(p, uint32_t(length));
+		std::memcpy(p, s, length);
+		p += length;
+	}
+
+	// the text output for channels that are not binary
+
+	static void formatText(Logger& out, const char* format) {
+
+		out << format;
+	}
+
+	template <typename T, typename... Rest>
+	static void formatText(Logger& out, const char* format, const T& t, const Rest&... rest) {
+
+		const char* placeholder = std::strstr(format, "{}");
+
+		// more arguments than placeholders, append them
+		if (!placeholder) {
+
+			out << format << " " << t;
+			formatText(out, "", rest...);
+			return;
+		}
+
+		// write the text before the placeholder without allocating
+		while (format != placeholder)
+			out << *format++;
+
+		out << t;
+		formatText(out, placeholder + 2, rest...);
+	}
+
+	// assign an id to the callsite and write its definition
+	static uint32_t define(Callsite& site, LogChannel& channel, const char* types);
+
+	// get a pointer to size bytes in the buffer of the current thread
+	static char* reserve(size_t size);
+};
+
+} // namespace logger
+
+#endif // UTIL_BINARY_LOG_H__
@@ -0,0 +1,397 @@
+#ifndef UTIL_CONCURRENT_CONT_MAP_H__
+#define UTIL_CONCURRENT_CONT_MAP_H__
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "cont_map.hpp"
+
+namespace util {
+
+/**
+ * A thread-safe variant of cont_map for keys with a numerical interpretation
+ * that are expected to be continuous.
+ *
+ * Slots are stored in fixed-size pages that are allocated on demand and never
+ * moved, such that the map can grow while other threads read from it. Pages
+ * are addressed through a directory of page tables with geometrically growing
+ * sizes (table k holds 2^k pages), which covers the whole key range with a
+ * constant number of table pointers.
+ *
+ * Lookups are lock-free: each page carries a sequence counter (a seqlock) that
+ * writers increment before and after modifying the page, and readers simply
+ * retry if the page was modified while they were copying a value. Writers
+ * synchronize on a mutex per page, so inserts into different key ranges never
+ * contend.
+ *
+ * Since values are handed out by copy, T has to be trivially copyable.
+ */
+template <
+		typename Key,
+		typename T,
+		typename NumConverter = identity<Key>,
+		unsigned PageBits = 10>
+class concurrent_cont_map {
+
+	static_assert(std::is_trivially_copyable<T>::value, "concurrent_cont_map needs a trivially copyable value type");
+
+public:
+
+	typedef Key                                   key_type;
+	typedef T                                     mapped_type;
+	typedef std::pair<Key, T>                     value_type;
+	typedef typename NumConverter::TargetType     num_key_type;
+	typedef std::size_t                           size_type;
+	typedef cont_map<Key, T, NumConverter>        snapshot_type;
+
+	static const size_type PageSize  = size_type(1) << PageBits;
+	// the last page of the key range is the only page of an additional table
+	static const size_type NumTables = 65 - PageBits;
+
+	concurrent_cont_map(const NumConverter& converter = NumConverter()) :
+		_converter(converter) {
+
+		for (size_type i = 0; i < NumTables; i++)
+			_tables[i].store(0, std::memory_order_relaxed);
+	}
+
+	~concurrent_cont_map() {
+
+		for (size_type t = 0; t < NumTables; t++) {
+
+			std::atomic<page*>* table = _tables[t].load(std::memory_order_relaxed);
+			if (!table)
+				continue;
+
+			for (size_type i = 0; i < table_size(t); i++)
+				delete table[i].load(std::memory_order_relaxed);
+
+			delete[] table;
+		}
+	}
+
+	// not copyable, pages are shared with concurrent readers
+	concurrent_cont_map(const concurrent_cont_map&) = delete;
+	concurrent_cont_map& operator=(const concurrent_cont_map&) = delete;
+
+	/**
+	 * Insert a value for the given key, if the key is not contained, yet.
+	 * Returns true, if the value was inserted.
+	 */
+	bool insert(const key_type& key, const mapped_type& value) {
+
+		return write(key, value, false);
+	}
+
+	bool insert(const value_type& value) {
+
+		return insert(value.first, value.second);
+	}
+
+	/**
+	 * Set the value for the given key, whether it is contained or not. Returns
+	 * true, if the key was not contained before.
+	 */
+	bool insert_or_assign(const key_type& key, const mapped_type& value) {
+
+		return write(key, value, true);
+	}
+
+	/**
+	 * Remove the given key. Returns the number of removed elements.
+	 */
+	size_type erase(const key_type& key) {
+
+		num_key_type k = _converter(key);
+		page* p = get_page(k, false);
+
+		if (!p)
+			return 0;
+
+		size_type i = slot(k);
+
+		std::lock_guard<std::mutex> lock(p->mutex);
+
+		if (!p->is_valid(i))
+			return 0;
+
+		p->begin_write();
+		p->valid[i/64].fetch_and(~(uint64_t(1) << (i%64)), std::memory_order_relaxed);
+		p->end_write();
+
+		p->size--;
+
+		return 1;
+	}
+
+	/**
+	 * Lock-free lookup. Copies the value for the given key into value and
+	 * returns true, if the key is contained.
+	 */
+	bool find(const key_type& key, mapped_type& value) const {
+
+		num_key_type k = _converter(key);
+		page* p = get_page(k);
+
+		if (!p)
+			return false;
+
+		return p->read(slot(k), value);
+	}
+
+	/**
+	 * Lock-free lookup. Throws std::out_of_range if the key is not contained.
+	 */
+	mapped_type at(const key_type& key) const {
+
+		mapped_type value;
+
+		if (!find(key, value))
+			throw std::out_of_range("util::concurrent_cont_map::at");
+
+		return value;
+	}
+
+	size_type count(const key_type& key) const {
+
+		num_key_type k = _converter(key);
+		page* p = get_page(k);
+
+		return p && p->is_valid(slot(k));
+	}
+
+	/**
+	 * The number of elements. If other threads are modifying the map
+	 * concurrently, this is only a momentary estimate.
+	 */
+	size_type size() const {
+
+		size_type n = 0;
+		for_each_page([&n](page& p, num_key_type) { n += p.size.load(std::memory_order_relaxed); });
+
+		return n;
+	}
+
+	bool empty() const { return size() == 0; }
+
+	/**
+	 * Visit all key-value pairs in ascending key order. Each page is copied
+	 * consistently before its elements are passed to f, i.e., f sees a
+	 * snapshot of every page, but not necessarily of the whole map.
+	 */
+	template <typename F>
+	void for_each(F f) const {
+
+		// too large for the stack with big values or pages
+		uint64_t                 valid[PageSize/64];
+		std::vector<mapped_type> values(PageSize);
+
+		for_each_page([&](page& p, num_key_type offset) {
+
+			p.copy(valid, &values[0]);
+
+			for (size_type w = 0; w < PageSize/64; w++)
+				for (uint64_t bits = valid[w]; bits; bits &= bits - 1) {
+
+					size_type i = w*64 + __builtin_ctzll(bits);
+					f(Key(offset + static_cast<num_key_type>(i)), values[i]);
+				}
+		});
+	}
+
+	/**
+	 * Create a cont_map with the current content of this map, e.g., for
+	 * iteration or read-heavy processing in a single thread.
+	 */
+	snapshot_type snapshot() const {
+
+		snapshot_type s(_converter);
+		for_each([&s](const Key& key, const mapped_type& value) { s[key] = value; });
+
+		return s;
+	}
+
+private:
+
+	struct page {
+
+		page() : seq(0), size(0) {
+
+			for (size_type w = 0; w < PageSize/64; w++)
+				valid[w].store(0, std::memory_order_relaxed);
+		}
+
+		bool is_valid(size_type i) const {
+
+			return valid[i/64].load(std::memory_order_acquire) & (uint64_t(1) << (i%64));
+		}
+
+		// writers have to hold the page mutex
+		void begin_write() {
+
+			seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+
+		void end_write() {
+
+			seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		bool read(size_type i, mapped_type& value) const {
+
+			while (true) {
+
+				unsigned before = seq.load(std::memory_order_acquire);
+				if (before & 1)
+					continue;
+
+				if (!is_valid(i))
+					return false;
+
+				value = values[i];
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (seq.load(std::memory_order_relaxed) == before)
+					return true;
+			}
+		}
+
+		void copy(uint64_t* validCopy, mapped_type* valuesCopy) const {
+
+			while (true) {
+
+				unsigned before = seq.load(std::memory_order_acquire);
+				if (before & 1)
+					continue;
+
+				for (size_type w = 0; w < PageSize/64; w++)
+					validCopy[w] = valid[w].load(std::memory_order_relaxed);
+				for (size_type i = 0; i < PageSize; i++)
+					valuesCopy[i] = values[i];
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (seq.load(std::memory_order_relaxed) == before)
+					return;
+			}
+		}
+
+		std::atomic<uint64_t> valid[PageSize/64];
+		std::atomic<unsigned> seq;
+		std::atomic<size_type> size;
+		std::mutex            mutex;
+		mapped_type           values[PageSize];
+	};
+
+	bool write(const key_type& key, const mapped_type& value, bool overwrite) {
+
+		num_key_type k = _converter(key);
+		page* p = get_page(k, true);
+		size_type i = slot(k);
+
+		std::lock_guard<std::mutex> lock(p->mutex);
+
+		bool contained = p->is_valid(i);
+		if (contained && !overwrite)
+			return false;
+
+		p->begin_write();
+		p->values[i] = value;
+		p->valid[i/64].fetch_or(uint64_t(1) << (i%64), std::memory_order_relaxed);
+		p->end_write();
+
+		if (!contained)
+			p->size++;
+
+		return !contained;
+	}
+
+	static size_type slot(num_key_type k) { return static_cast<size_type>(k) & (PageSize - 1); }
+
+	// page n is the (n+1-2^t)-th entry of table t, with t = floor(log2(n+1))
+	static size_type table_of(size_type n) { return 63 - __builtin_clzll(n + 1); }
+
+	// the last table holds only the last page
+	static size_type table_size(size_type t) { return t + 1 < NumTables ? size_type(1) << t : 1; }
+
+	page* get_page(num_key_type k, bool create = false) const {
+
+		// negative keys are never contained, but can not be inserted
+		if (k < 0) {
+
+			if (!create)
+				return 0;
+
+			throw std::out_of_range("util::concurrent_cont_map: negative key");
+		}
+
+		size_type n = static_cast<size_type>(k) >> PageBits;
+		size_type t = table_of(n);
+		size_type i = n + 1 - (size_type(1) << t);
+
+		std::atomic<page*>* table = _tables[t].load(std::memory_order_acquire);
+
+		if (!table) {
+
+			if (!create)
+				return 0;
+
+			std::atomic<page*>* fresh = new std::atomic<page*>[table_size(t)];
+			for (size_type j = 0; j < table_size(t); j++)
+				fresh[j].store(0, std::memory_order_relaxed);
+
+			if (_tables[t].compare_exchange_strong(table, fresh, std::memory_order_acq_rel))
+				table = fresh;
+			else
+				delete[] fresh;
+		}
+
+		page* p = table[i].load(std::memory_order_acquire);
+
+		if (!p) {
+
+			if (!create)
+				return 0;
+
+			page* fresh = new page();
+
+			if (table[i].compare_exchange_strong(p, fresh, std::memory_order_acq_rel))
+				p = fresh;
+			else
+				delete fresh;
+		}
+
+		return p;
+	}
+
+	// call f(page, key offset) for all allocated pages in ascending order
+	template <typename F>
+	void for_each_page(F f) const {
+
+		for (size_type t = 0; t < NumTables; t++) {
+
+			std::atomic<page*>* table = _tables[t].load(std::memory_order_acquire);
+			if (!table)
+				continue;
+
+			for (size_type i = 0; i < table_size(t); i++) {
+
+				page* p = table[i].load(std::memory_order_acquire);
+				if (p)
+					f(*p, static_cast<num_key_type>(((size_type(1) << t) - 1 + i) << PageBits));
+			}
+		}
+	}
+
+	mutable std::atomic<std::atomic<page*>*> _tables[NumTables];
+
+	NumConverter _converter;
+};
+
+} // namespace util
+
+#endif // UTIL_CONCURRENT_CONT_MAP_H__
@@ -5,6 +5,8 @@
 #include <map>
 #include <stdexcept>
 
+#include "rank_select.hpp"
+
 namespace util {
 
 /**
@@ -28,6 +30,10 @@ struct identity {
  * keys that are not the same as the index, but point to the next valid element 
  * for fast forward iteration. Consequently, backward iteration is slower than 
  * forward iteration.
+ *
+ * Additionally, the validity of each element is kept in a rank/select bit
+ * vector, which allows to count the valid keys in a range, to find the n-th
+ * valid key, and to map keys to a dense index in O(log n).
  */
 template <
 		typename Key,
@@ -90,11 +96,11 @@ public:
 			Direction::skip_invalids(_i);
 		}
 
-		value_type&       operator*()       { return _list[_i]; }
-		const value_type& operator*() const { return _list[_i]; }
+		value_type&       operator*()       { return _list[Direction::position(_i)]; }
+		const value_type& operator*() const { return _list[Direction::position(_i)]; }
 
-		      value_type* operator->()       { return &_list[_i]; }
-		const value_type* operator->() const { return &_list[_i]; }
+		      value_type* operator->()       { return &_list[Direction::position(_i)]; }
+		const value_type* operator->() const { return &_list[Direction::position(_i)]; }
 
 		iterator_type        operator++(int)       {       iterator_type p = *this; Direction::inc(_i); return p; }
 		const iterator_type  operator++(int) const { const iterator_type p = *this; Direction::inc(_i); return p; }
@@ -123,6 +129,8 @@ public:
 
 		void inc(num_key_type& i) const { i++; skip_invalids(i); }
 
+		num_key_type position(num_key_type i) const { return i; }
+
 	protected:
 
 		num_key_type end() const { return _list.size(); }
@@ -158,6 +166,8 @@ public:
 
 		void inc(num_key_type& i) const { i--; skip_invalids(i); }
 
+		num_key_type position(num_key_type i) const { return i - 1; }
+
 	protected:
 
 		num_key_type end() const { return 0; }
@@ -189,16 +199,16 @@ public:
 	const_iterator begin() const { return iterator(_list, 0, _converter); }
 	const_iterator end() const { return iterator(_list, _list.size(), _converter); }
 	reverse_iterator rbegin() { return reverse_iterator(_list, _list.size() - 1, _converter); }
-	reverse_iterator rend() { return ++reverse_iterator(_list, 0, _converter); }
+	reverse_iterator rend() { return reverse_iterator(_list, static_cast<num_key_type>(-1), _converter); }
 	const_reverse_iterator rbegin() const { return reverse_iterator(_list, _list.size() - 1, _converter); }
-	const_reverse_iterator rend() const { return ++reverse_iterator(_list, 0, _converter); }
+	const_reverse_iterator rend() const { return reverse_iterator(_list, static_cast<num_key_type>(-1), _converter); }
 
 	// capacity
-	bool empty() { return _size == 0; }
-	size_type size() { return _size; }
-	size_type max_size() { return _list.max_size(); }
+	bool empty() const { return _size == 0; }
+	size_type size() const { return _size; }
+	size_type max_size() const { return _list.max_size(); }
 
-	double overhead() { return (double)_list.size()/size(); }
+	double overhead() const { return (double)_list.size()/size(); }
 
 	// element access
 	inline mapped_type& operator[](const key_type& key) {
@@ -212,6 +222,7 @@ public:
 			reverse_iterator prev_valid(_list, k, _converter);
 			for (num_key_type i = prev_valid.index(); i <= k; i++)
 				_list[i].first = key;
+			_valid.set(k);
 			_size++;
 		}
 
@@ -248,8 +259,10 @@ public:
 		bool contained = is_valid(k);
 
 		_list[k] = value;
-		if (!contained)
+		if (!contained) {
+			_valid.set(k);
 			_size++;
+		}
 
 		return std::make_pair(iterator(_list, k, _converter), contained);
 	}
@@ -283,15 +296,17 @@ public:
 		for (num_key_type i = prev_valid.index(); i <= position.index(); i++)
 			_list[i].first = _converter(next_valid.index());
 
+		_valid.reset(position.index());
 		_size--;
 	}
 
 	size_type erase(const key_type& key) {
 
-		iterator position(_list, _converter(key), _converter);
-		if (position == end())
+		if (!count(key))
 			return 0;
 
+		iterator position(_list, _converter(key), _converter);
+
 		erase(position);
 		return 1;
 	}
@@ -305,12 +320,14 @@ public:
 
 	void swap(map_type& other) {
 		_list.swap(other._list);
+		_valid.swap(other._valid);
 		std::swap(_size, other._size);
 		std::swap(_converter, other._converter);
 	}
 
 	void clear() {
 		_list.clear();
+		_valid.clear();
 		_size = 0;
 	}
 
@@ -357,6 +374,66 @@ public:
 		return std::make_pair(lower_bound(key), upper_bound(key));
 	}
 
+	// rank and select
+
+	/**
+	 * The number of valid keys that are smaller than the given key.
+	 */
+	size_type rank(const key_type& key) const {
+		num_key_type k = _converter(key);
+		if (k < 0)
+			return 0;
+		return _valid.rank(k);
+	}
+
+	/**
+	 * The number of valid keys in [first, last).
+	 */
+	size_type count_range(const key_type& first, const key_type& last) const {
+		num_key_type a = _converter(first);
+		num_key_type b = _converter(last);
+		if (b <= a)
+			return 0;
+		return rank(last) - rank(first);
+	}
+
+	/**
+	 * Get an iterator to the n-th (starting with 0) valid element, or end() if 
+	 * there are not more than n elements.
+	 */
+	iterator nth(size_type n) {
+		return iterator(_list, _valid.select(n), _converter);
+	}
+	const_iterator nth(size_type n) const {
+		// const_iterator gives only const access to the list
+		return const_iterator(const_cast<list_type&>(_list), _valid.select(n), const_cast<NumConverter&>(_converter));
+	}
+
+	/**
+	 * Get the position of the given key among all valid keys, i.e., a dense 
+	 * index in [0, size()). Throws std::out_of_range if the key is not 
+	 * contained.
+	 */
+	size_type dense_index(const key_type& key) const {
+		if (!count(key))
+			throw std::out_of_range("util::cont_map::dense_index");
+		return _valid.rank(_converter(key));
+	}
+
+	// raw slot access
+
+	/**
+	 * Direct access to the internal slots, e.g., for serialization. Slots of 
+	 * invalid elements have keys that point to the next valid element.
+	 */
+	const value_type* data() const { return _list.data(); }
+
+	/**
+	 * The number of internal slots, i.e., one more than the largest numerical 
+	 * key seen so far.
+	 */
+	size_type num_slots() const { return _list.size(); }
+
 	// allocator
 	allocator_type get_allocator() const { return _list.get_allocator(); }
 
@@ -373,6 +450,7 @@ private:
 			// create new fields at the end, with keys that point to the 
 			// one-past last element (which is k+1)
 			_list.resize(k+1, std::make_pair(_converter(k+1), T()));
+			_valid.resize(k+1);
 		}
 	}
 
@@ -384,6 +462,7 @@ private:
 	}
 
 	list_type    _list;
+	rank_select  _valid;
 	size_type    _size;
 	NumConverter _converter;
 };
@@ -0,0 +1,329 @@
+#ifndef UTIL_CONT_SET_H__
+#define UTIL_CONT_SET_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "cont_map.hpp"
+
+namespace util {
+
+/**
+ * Implements a std::set interface for keys that have a numerical
+ * interpretation and are expected to be continuous.
+ *
+ * This is the value-less counterpart to cont_map: Keys are stored as bits of a
+ * word-packed bit vector, such that bit i is set if the key with numerical
+ * interpretation i is contained. Iteration skips empty words and finds the
+ * next key with count-trailing-zeros. Union, intersection and difference of
+ * two sets are performed word-wise (using SSE2, if available).
+ */
+template <
+		typename Key,
+		typename NumConverter = identity<Key> >
+class cont_set {
+
+public:
+
+	typedef cont_set<Key, NumConverter>        set_type;
+	typedef typename NumConverter::TargetType  num_key_type;
+
+	// set interface
+	typedef Key          key_type;
+	typedef Key          value_type;
+	typedef std::size_t  size_type;
+
+	////////////////////////////////////////////////////////////////////////////////
+	// iterator
+	////////////////////////////////////////////////////////////////////////////////
+
+	class cont_set_iterator {
+
+	public:
+
+		typedef std::forward_iterator_tag iterator_category;
+		typedef Key                       value_type;
+		typedef std::ptrdiff_t            difference_type;
+		typedef const Key*                pointer;
+		typedef Key                       reference;
+
+		cont_set_iterator(const std::vector<uint64_t>& words, size_type i) :
+			_words(&words),
+			_i(i) {
+
+			skip_invalids();
+		}
+
+		Key operator*() const { return Key(static_cast<num_key_type>(_i)); }
+
+		cont_set_iterator  operator++(int) { cont_set_iterator p = *this; ++(*this); return p; }
+		cont_set_iterator& operator++()    { _i++; skip_invalids(); return *this; }
+
+		bool operator==(const cont_set_iterator& other) const { return _i == other._i; }
+		bool operator!=(const cont_set_iterator& other) const { return _i != other._i; }
+
+		inline num_key_type index() const { return _i; }
+
+	private:
+
+		void skip_invalids() {
+
+			size_type end = _words->size()*64;
+
+			if (_i >= end) {
+
+				_i = end;
+				return;
+			}
+
+			size_type w = _i/64;
+			uint64_t bits = (*_words)[w] & (~uint64_t(0) << (_i%64));
+
+			while (!bits && ++w < _words->size())
+				bits = (*_words)[w];
+
+			_i = (bits ? w*64 + __builtin_ctzll(bits) : end);
+		}
+
+		const std::vector<uint64_t>* _words;
+		size_type                    _i;
+	};
+
+	typedef cont_set_iterator iterator;
+	typedef cont_set_iterator const_iterator;
+
+	////////////////////////////////////////////////////////////////////////////////
+	// member functions
+	////////////////////////////////////////////////////////////////////////////////
+
+	cont_set(const NumConverter& converter = NumConverter()) :
+		_size(0),
+		_converter(converter) {}
+
+	template <class InputIterator>
+	cont_set(InputIterator first, InputIterator last, const NumConverter& converter = NumConverter()) :
+		_size(0),
+		_converter(converter) {
+
+		insert(first, last);
+	}
+
+	// iterators
+	const_iterator begin() const { return const_iterator(_words, 0); }
+	const_iterator end() const { return const_iterator(_words, _words.size()*64); }
+
+	// capacity
+	bool empty() const { return _size == 0; }
+	size_type size() const { return _size; }
+	size_type max_size() const { return _words.max_size()*64; }
+
+	double overhead() const { return (double)_words.size()*64/size(); }
+
+	// modifiers
+	std::pair<iterator, bool> insert(const value_type& key) {
+
+		num_key_type k = _converter(key);
+
+		accomodate(k);
+
+		uint64_t& word = _words[k/64];
+		uint64_t  bit  = uint64_t(1) << (k%64);
+		bool inserted = !(word & bit);
+
+		word |= bit;
+		if (inserted)
+			_size++;
+
+		return std::make_pair(iterator(_words, k), inserted);
+	}
+
+	iterator insert(iterator /*position*/, const value_type& key) {
+		return insert(key).first;
+	}
+	template <class InputIterator>
+	void insert(InputIterator first, InputIterator last) {
+		while (first != last) {
+			insert(*first);
+			first++;
+		}
+	}
+
+	size_type erase(const key_type& key) {
+
+		if (!count(key))
+			return 0;
+
+		num_key_type k = _converter(key);
+		_words[k/64] &= ~(uint64_t(1) << (k%64));
+		_size--;
+
+		return 1;
+	}
+
+	void erase(iterator position) {
+
+		if (position != end())
+			erase(*position);
+	}
+
+	void swap(set_type& other) {
+		_words.swap(other._words);
+		std::swap(_size, other._size);
+		std::swap(_converter, other._converter);
+	}
+
+	void clear() {
+		_words.clear();
+		_size = 0;
+	}
+
+	// operations
+	const_iterator find(const key_type& key) const {
+		if (count(key))
+			return const_iterator(_words, _converter(key));
+		return end();
+	}
+
+	size_type count(const key_type& key) const {
+		num_key_type k = _converter(key);
+		return k >= 0 && static_cast<size_type>(k/64) < _words.size() && (_words[k/64] & (uint64_t(1) << (k%64)));
+	}
+
+	// negative keys are smaller than all keys of the set
+
+	const_iterator lower_bound(const key_type& key) const {
+		num_key_type k = _converter(key);
+		return const_iterator(_words, k < 0 ? 0 : k);
+	}
+
+	const_iterator upper_bound(const key_type& key) const {
+		num_key_type k = _converter(key);
+		return const_iterator(_words, k < 0 ? 0 : k + 1);
+	}
+
+	// set algebra
+
+	/**
+	 * Add all keys of other to this set.
+	 */
+	set_type& operator|=(const set_type& other) {
+
+		if (other._words.size() > _words.size())
+			_words.resize(other._words.size(), 0);
+
+		apply(other, or_op());
+
+		return *this;
+	}
+
+	/**
+	 * Remove all keys from this set that are not in other.
+	 */
+	set_type& operator&=(const set_type& other) {
+
+		if (_words.size() > other._words.size())
+			_words.resize(other._words.size());
+
+		apply(other, and_op());
+
+		return *this;
+	}
+
+	/**
+	 * Remove all keys of other from this set.
+	 */
+	set_type& operator-=(const set_type& other) {
+
+		apply(other, andnot_op());
+
+		return *this;
+	}
+
+	set_type operator|(const set_type& other) const { set_type result(*this); return result |= other; }
+	set_type operator&(const set_type& other) const { set_type result(*this); return result &= other; }
+	set_type operator-(const set_type& other) const { set_type result(*this); return result -= other; }
+
+	bool operator==(const set_type& other) const {
+
+		size_type common = std::min(_words.size(), other._words.size());
+
+		return
+				_size == other._size &&
+				std::equal(_words.begin(), _words.begin() + common, other._words.begin());
+	}
+
+	bool operator!=(const set_type& other) const { return !(*this == other); }
+
+private:
+
+	struct or_op {
+		uint64_t operator()(uint64_t a, uint64_t b) const { return a | b; }
+#ifdef __SSE2__
+		__m128i operator()(__m128i a, __m128i b) const { return _mm_or_si128(a, b); }
+#endif
+	};
+
+	struct and_op {
+		uint64_t operator()(uint64_t a, uint64_t b) const { return a & b; }
+#ifdef __SSE2__
+		__m128i operator()(__m128i a, __m128i b) const { return _mm_and_si128(a, b); }
+#endif
+	};
+
+	struct andnot_op {
+		uint64_t operator()(uint64_t a, uint64_t b) const { return a & ~b; }
+#ifdef __SSE2__
+		// _mm_andnot_si128 negates its first argument
+		__m128i operator()(__m128i a, __m128i b) const { return _mm_andnot_si128(b, a); }
+#endif
+	};
+
+	// combine the first min(size, other.size) words of this set with other's
+	// words, and recount the number of keys
+	template <typename Op>
+	void apply(const set_type& other, Op op) {
+
+		size_type n = std::min(_words.size(), other._words.size());
+		size_type w = 0;
+
+		uint64_t*       a = _words.data();
+		const uint64_t* b = other._words.data();
+
+#ifdef __SSE2__
+		for (; w + 2 <= n; w += 2) {
+
+			__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + w));
+			__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + w));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(a + w), op(va, vb));
+		}
+#endif
+		for (; w < n; w++)
+			a[w] = op(a[w], b[w]);
+
+		_size = 0;
+		for (uint64_t word : _words)
+			_size += __builtin_popcountll(word);
+	}
+
+	// grow the bit vector to accomodate keys with numerical value k
+	inline void accomodate(num_key_type k) {
+
+		if (static_cast<size_type>(k/64) >= _words.size())
+			_words.resize(k/64 + 1, 0);
+	}
+
+	std::vector<uint64_t> _words;
+	size_type             _size;
+	NumConverter          _converter;
+};
+
+} // namespace util
+
+#endif // UTIL_CONT_SET_H__
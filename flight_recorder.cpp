@@ -0,0 +1,336 @@
+#include <config.h>
+#include <algorithm>
+#include <climits>
+#include "ProgramOptions.h"
+#include "exceptions.h"
+#include "flight_recorder.h"
+#include "timing.h"
+
+#if defined(SYSTEM_UNIX) && !defined(SYSTEM_MAC)
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+util::ProgramOption optionFlightRecorder(
+		util::_module = "FlightRecorder",
+		util::_long_name = "flight-recorder",
+		util::_description_text =
+		"Keep the most recent timer events and log messages of each thread and "
+		"write them to --flight-recorder-file on a segfault or abort.",
+		util::_default_value = true);
+
+util::ProgramOption optionFlightRecorderFile(
+		util::_module = "FlightRecorder",
+		util::_long_name = "flight-recorder-file",
+		util::_description_text =
+		"The file to write the flight recorder to. Defaults to "
+		"flight-recorder.<pid>.txt in the working directory.",
+		util::_argument_sketch = "file");
+
+std::atomic<FlightRecorder::Ring*> FlightRecorder::_rings(0);
+
+thread_local FlightRecorder::Ring* FlightRecorder::_ring = 0;
+
+std::atomic<bool> FlightRecorder::_enabled(true);
+
+namespace {
+
+thread_local bool released = false;
+
+// the name of the dump file, set by init()
+char dumpFile[PATH_MAX] = { 0 };
+
+std::atomic<bool> dumped(false);
+
+// the timestamp and monotonic time at startup, to convert timestamps to
+// nanoseconds in dump() without calibration
+struct StartTime {
+
+	StartTime() :
+		timestamp(FlightRecorder::timestamp()),
+		nanoseconds(FlightRecorder::monotonicTime()) {}
+
+	uint64_t timestamp;
+	uint64_t nanoseconds;
+};
+
+const StartTime startTime;
+
+#if defined(SYSTEM_UNIX) && !defined(SYSTEM_MAC)
+
+long threadId() {
+
+	return syscall(SYS_gettid);
+}
+
+/**
+ * Buffered output to a file descriptor, using only async-signal-safe
+ * functions.
+ */
+class SignalSafeWriter {
+
+public:
+
+	SignalSafeWriter(int fd) :
+		_fd(fd),
+		_size(0) {}
+
+	~SignalSafeWriter() {
+
+		flush();
+	}
+
+	SignalSafeWriter& operator<<(const char* text) {
+
+		while (*text)
+			put(*text++);
+
+		return *this;
+	}
+
+	SignalSafeWriter& operator<<(uint64_t number) {
+
+		char digits[20];
+		int  n = 0;
+
+		do {
+
+			digits[n++] = '0' + number%10;
+			number /= 10;
+
+		} while (number > 0);
+
+		while (n > 0)
+			put(digits[--n]);
+
+		return *this;
+	}
+
+	void write(const char* text, size_t length) {
+
+		for (size_t i = 0; i < length; i++)
+			put(text[i]);
+	}
+
+	void flush() {
+
+		size_t written = 0;
+		while (written < _size) {
+
+			ssize_t result = ::write(_fd, _buffer + written, _size - written);
+			if (result <= 0)
+				break;
+			written += result;
+		}
+
+		_size = 0;
+	}
+
+private:
+
+	void put(char c) {
+
+		if (_size == sizeof(_buffer))
+			flush();
+
+		_buffer[_size++] = c;
+	}
+
+	int    _fd;
+	char   _buffer[4096];
+	size_t _size;
+};
+
+#endif // SYSTEM_UNIX && !SYSTEM_MAC
+
+} // anonymous namespace
+
+void
+FlightRecorder::init() {
+
+	setEnabled(optionFlightRecorder);
+
+	if (optionFlightRecorderFile) {
+
+		std::string file = optionFlightRecorderFile;
+
+		if (file.size() >= sizeof(dumpFile))
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"the name of the flight recorder file is too long: " << file);
+
+		std::strcpy(dumpFile, file.c_str());
+	}
+}
+
+FlightRecorder::Ring*
+FlightRecorder::acquireRing() {
+
+	if (released)
+		return 0;
+
+	static thread_local RingRelease release;
+
+	Ring* ring;
+
+	// reuse the ring of an ended thread
+	for (ring = _rings.load(std::memory_order_acquire); ring; ring = ring->link) {
+
+		bool used = false;
+		if (ring->used.compare_exchange_strong(used, true))
+			break;
+	}
+
+	if (!ring) {
+
+		ring = new Ring();
+		ring->used.store(true, std::memory_order_relaxed);
+
+		ring->link = _rings.load(std::memory_order_relaxed);
+		while (!_rings.compare_exchange_weak(ring->link, ring, std::memory_order_release))
+			;
+	}
+
+	ring->next.store(0, std::memory_order_relaxed);
+#if defined(SYSTEM_UNIX) && !defined(SYSTEM_MAC)
+	ring->tid.store(threadId(), std::memory_order_release);
+#endif
+
+	release.ring = ring;
+	_ring = ring;
+
+	return ring;
+}
+
+FlightRecorder::RingRelease::~RingRelease() {
+
+	released = true;
+	_ring    = 0;
+
+	if (!ring)
+		return;
+
+	ring->tid.store(0, std::memory_order_relaxed);
+	ring->used.store(false, std::memory_order_release);
+}
+
+void
+FlightRecorder::dump() {
+
+#if defined(SYSTEM_UNIX) && !defined(SYSTEM_MAC)
+
+	if (!isEnabled() || dumped.exchange(true))
+		return;
+
+	char file[PATH_MAX];
+
+	if (dumpFile[0]) {
+
+		std::strcpy(file, dumpFile);
+
+	} else {
+
+		// flight-recorder.<pid>.txt
+		const char* prefix = "flight-recorder.";
+		const char* suffix = ".txt";
+
+		char pid[20];
+		int  n = 0;
+		for (pid_t p = getpid(); p > 0; p /= 10)
+			pid[n++] = '0' + p%10;
+
+		char* f = file;
+		for (const char* c = prefix; *c; c++)
+			*f++ = *c;
+		while (n > 0)
+			*f++ = pid[--n];
+		for (const char* c = suffix; *c; c++)
+			*f++ = *c;
+		*f = 0;
+	}
+
+	int fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return;
+
+	dump(fd);
+	close(fd);
+
+	SignalSafeWriter(STDERR_FILENO) << "flight recorder written to " << file << "\n";
+
+#endif
+}
+
+void
+FlightRecorder::dump(int fd) {
+
+#if defined(SYSTEM_UNIX) && !defined(SYSTEM_MAC)
+
+	SignalSafeWriter out(fd);
+
+	uint64_t now         = timestamp();
+	uint64_t nanoseconds = monotonicTime();
+
+	double nanosecondsPerTick = 1;
+	if (now > startTime.timestamp && nanoseconds > startTime.nanoseconds)
+		nanosecondsPerTick = double(nanoseconds - startTime.nanoseconds)/(now - startTime.timestamp);
+
+	long current = threadId();
+
+	out
+			<< "flight recorder of process " << (uint64_t)getpid()
+			<< ", the last " << (uint64_t)Capacity << " events of each thread, "
+			<< "times in microseconds before the dump\n";
+
+	for (Ring* ring = _rings.load(std::memory_order_acquire); ring; ring = ring->link) {
+
+		if (!ring->used.load(std::memory_order_acquire))
+			continue;
+
+		long     tid  = ring->tid.load(std::memory_order_acquire);
+		uint64_t next = ring->next.load(std::memory_order_acquire);
+
+		out << "\nthread " << (uint64_t)tid << (tid == current ? " (received the signal)" : "") << ":\n";
+
+		for (uint64_t i = (next > Capacity ? next - Capacity : 0); i < next; i++) {
+
+			const Event& event = ring->events[i % Capacity];
+
+			// print as -<microseconds>.<nanoseconds>
+			uint64_t age = (now > event.time ? (now - event.time)*nanosecondsPerTick : 0);
+			uint64_t us  = age/1000;
+			uint64_t ns  = age%1000;
+
+			out << "  -" << us << "." << (ns < 100 ? "0" : "") << (ns < 10 ? "0" : "") << ns;
+
+			switch (event.type) {
+
+				case Begin:
+				case End: {
+
+					const char* identifier = TimingStatistics::findIdentifier(event.id);
+
+					out << (event.type == Begin ? "  begin  " : "  end    ");
+					if (identifier)
+						out << identifier;
+					else
+						out << "timer " << (uint64_t)event.id;
+					break;
+				}
+
+				case Marker:
+					out << "  log    ";
+					out.write(event.text, std::min<size_t>(event.length, MarkerLength));
+					break;
+
+				default:
+					out << "  ?";
+			}
+
+			out << "\n";
+		}
+	}
+
+#endif
+}
@@ -0,0 +1,185 @@
+#ifndef UTIL_FLIGHT_RECORDER_H__
+#define UTIL_FLIGHT_RECORDER_H__
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Keeps the most recent Timer begin and end events and log messages of each
+ * thread, to be dumped when the program crashes.
+ *
+ * Each thread writes to its own ring of Capacity events without locks, older
+ * events are overwritten. SignalHandler calls dump() on SIGSEGV and SIGABRT,
+ * which writes the rings of all threads to --flight-recorder-file using only
+ * async-signal-safe functions. Threads other than the crashing one keep
+ * running while the dump is written, so their newest event might be
+ * incomplete.
+ *
+ * Recording is on by default and can be switched off with setEnabled() or
+ * --flight-recorder=false. Every event costs a read of the time stamp counter
+ * (on x86, the monotonic clock otherwise) and a copy into the ring.
+ */
+class FlightRecorder {
+
+public:
+
+	enum EventType {
+
+		Begin = 1,
+		End,
+		Marker
+	};
+
+	/**
+	 * The number of events kept per thread.
+	 */
+	static const unsigned int Capacity = 256;
+
+	/**
+	 * The number of characters of a log message kept per event.
+	 */
+	static const unsigned int MarkerLength = 50;
+
+	/**
+	 * Read the options and prepare the dump file name. Called by
+	 * SignalHandler::init().
+	 */
+	static void init();
+
+	static void setEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+	static bool isEnabled() { return _enabled.load(std::memory_order_relaxed); }
+
+	/**
+	 * Record the begin and end of the timer with the given id in the current
+	 * thread.
+	 */
+	static void scopeBegin(unsigned int id) { if (isEnabled()) record(Begin, id, 0, 0); }
+
+	static void scopeEnd(unsigned int id) { if (isEnabled()) record(End, id, 0, 0); }
+
+	/**
+	 * Record the first MarkerLength characters of a log message in the current
+	 * thread.
+	 */
+	static void mark(const char* text, size_t length) { if (isEnabled()) record(Marker, 0, text, length); }
+
+	static void mark(const std::string& text) { mark(text.c_str(), text.size()); }
+
+	/**
+	 * Write the events of all threads to the dump file, if the recorder is
+	 * enabled. Async-signal-safe, the file is only written on the first call.
+	 */
+	static void dump();
+
+	/**
+	 * Write the events of all threads to the given file descriptor.
+	 * Async-signal-safe.
+	 */
+	static void dump(int fd);
+
+	/**
+	 * The time stamp of events: TSC ticks on x86 (converted to nanoseconds in
+	 * dump()), nanoseconds of the monotonic clock otherwise.
+	 */
+	static inline uint64_t timestamp() {
+
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return monotonicTime();
+#endif
+	}
+
+	static inline uint64_t monotonicTime() {
+
+		timespec t;
+		clock_gettime(CLOCK_MONOTONIC, &t);
+
+		return uint64_t(t.tv_sec)*1000000000 + t.tv_nsec;
+	}
+
+private:
+
+	struct Event {
+
+		// see timestamp()
+		uint64_t time;
+
+		uint32_t id;
+		uint8_t  type;
+		uint8_t  length;
+		char     text[MarkerLength];
+	};
+
+	// the ring of one thread, reused after the thread ended
+	struct Ring {
+
+		std::atomic<uint64_t> next;
+
+		Event events[Capacity];
+
+		std::atomic<bool> used;
+
+		// the system thread id of the owner
+		std::atomic<long> tid;
+
+		Ring* link;
+	};
+
+	static inline void record(EventType type, unsigned int id, const char* text, size_t length) {
+
+		Ring* ring = _ring;
+		if (!ring && !(ring = acquireRing()))
+			return;
+
+		uint64_t next  = ring->next.load(std::memory_order_relaxed);
+		Event&   event = ring->events[next % Capacity];
+
+		event.time = timestamp();
+		event.id   = id;
+		event.type = type;
+
+		if (text) {
+
+			// without the trailing newline of log messages
+			while (length > 0 && (text[length - 1] == '\n' || text[length - 1] == '\r'))
+				length--;
+
+			event.length = (length < MarkerLength ? length : MarkerLength);
+			std::memcpy(event.text, text, event.length);
+		}
+
+		// publish the event to dump()
+		ring->next.store(next + 1, std::memory_order_release);
+	}
+
+	// find an unused ring or create a new one for the current thread, returns
+	// 0 if the thread already released its ring
+	static Ring* acquireRing();
+
+	// releases the ring of a thread when the thread ends
+	struct RingRelease {
+
+		RingRelease() : ring(0) {}
+
+		~RingRelease();
+
+		Ring* ring;
+	};
+
+	// the list of all rings
+	static std::atomic<Ring*> _rings;
+
+	static thread_local Ring* _ring;
+
+	static std::atomic<bool> _enabled;
+};
+
+#endif // UTIL_FLIGHT_RECORDER_H__
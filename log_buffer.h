@@ -0,0 +1,226 @@
+#ifndef UTIL_LOG_BUFFER_H__
+#define UTIL_LOG_BUFFER_H__
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace logger {
+
+/**
+ * The characters of the line a thread is currently writing to a Logger. The
+ * memory is reused for all lines and only grows if a line is longer than all
+ * lines before.
+ */
+class LogBuffer : public std::streambuf {
+
+public:
+
+	static const size_t InitialCapacity = 1024;
+
+	LogBuffer() :
+		_data(InitialCapacity) {
+
+		clear();
+	}
+
+	const char* data() const { return pbase(); }
+
+	size_t size() const { return pptr() - pbase(); }
+
+	void clear() { setp(&_data[0], &_data[0] + _data.size()); }
+
+	void append(const char* s, size_t n) {
+
+		if (size_t(epptr() - pptr()) < n)
+			grow(size() + n);
+
+		std::memcpy(pptr(), s, n);
+		pbump(n);
+	}
+
+	void append(char c) {
+
+		if (pptr() == epptr())
+			grow(size() + 1);
+
+		*pptr() = c;
+		pbump(1);
+	}
+
+protected:
+
+	int_type overflow(int_type c) {
+
+		if (!traits_type::eq_int_type(c, traits_type::eof()))
+			append(traits_type::to_char_type(c));
+
+		return traits_type::not_eof(c);
+	}
+
+	std::streamsize xsputn(const char* s, std::streamsize n) {
+
+		append(s, n);
+
+		return n;
+	}
+
+private:
+
+	void grow(size_t required) {
+
+		size_t used = size();
+
+		_data.resize(std::max(required, 2*_data.size()));
+		setp(&_data[0], &_data[0] + _data.size());
+		pbump(used);
+	}
+
+	std::vector<char> _data;
+};
+
+/**
+ * A stream writing to a LogBuffer, with fast paths for strings, characters,
+ * and numbers that bypass the iostream formatting if no width, base, or other
+ * flags are set. Other types and formats are written with operator<<.
+ */
+class LogStream : public std::ostream {
+
+public:
+
+	LogStream() :
+		std::ostream(&_buffer) {}
+
+	LogBuffer& buffer() { return _buffer; }
+
+	void format(const char* s) {
+
+		if (width() == 0 && s)
+			_buffer.append(s, std::strlen(s));
+		else
+			*this << s;
+	}
+
+	void format(const std::string& s) {
+
+		if (width() == 0)
+			_buffer.append(s.data(), s.size());
+		else
+			*this << s;
+	}
+
+	void format(char c) {
+
+		if (width() == 0)
+			_buffer.append(c);
+		else
+			*this << c;
+	}
+
+	void format(bool b)               { if (plainIntegers() && !(flags() & boolalpha)) _buffer.append(b ? '1' : '0'); else *this << b; }
+	void format(short i)              { formatSigned(i); }
+	void format(int i)                { formatSigned(i); }
+	void format(long i)               { formatSigned(i); }
+	void format(long long i)          { formatSigned(i); }
+	void format(unsigned short i)     { formatUnsigned(i); }
+	void format(unsigned int i)       { formatUnsigned(i); }
+	void format(unsigned long i)      { formatUnsigned(i); }
+	void format(unsigned long long i) { formatUnsigned(i); }
+
+	void format(float f)  { formatFloat(f); }
+	void format(double d) { formatFloat(d); }
+
+	template <typename T>
+	void format(const T& t) {
+
+		*this << t;
+	}
+
+private:
+
+	bool plainIntegers() const {
+
+		return width() == 0 && (flags() & (basefield | showpos)) == dec;
+	}
+
+	template <typename T>
+	void formatSigned(T i) {
+
+		if (!plainIntegers()) {
+
+			*this << i;
+			return;
+		}
+
+		unsigned long long u = i;
+		if (i < 0) {
+
+			_buffer.append('-');
+			u = -u;
+		}
+
+		appendDigits(u);
+	}
+
+	template <typename T>
+	void formatUnsigned(T i) {
+
+		if (plainIntegers())
+			appendDigits(i);
+		else
+			*this << i;
+	}
+
+	void appendDigits(unsigned long long u) {
+
+		char digits[20];
+		int  n = sizeof(digits);
+
+		do {
+
+			digits[--n] = '0' + u%10;
+			u /= 10;
+
+		} while (u > 0);
+
+		_buffer.append(digits + n, sizeof(digits) - n);
+	}
+
+	void formatFloat(double d) {
+
+		// the conversions of printf that match the iostream float formats
+		fmtflags    format     = flags() & (floatfield | showpos | showpoint | uppercase);
+		const char* conversion = 0;
+
+		if (format == fmtflags())
+			conversion = "%.*g";
+		else if (format == fixed)
+			conversion = "%.*f";
+		else if (format == scientific)
+			conversion = "%.*e";
+
+		if (width() == 0 && conversion) {
+
+			char s[32];
+			int  n = std::snprintf(s, sizeof(s), conversion, (int)precision(), d);
+
+			if (n > 0 && n < (int)sizeof(s)) {
+
+				_buffer.append(s, n);
+				return;
+			}
+		}
+
+		*this << d;
+	}
+
+	LogBuffer _buffer;
+};
+
+} // namespace logger
+
+#endif // UTIL_LOG_BUFFER_H__
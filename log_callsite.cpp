@@ -0,0 +1,84 @@
+#include "Logger.h"
+#include "log_callsite.h"
+
+namespace logger {
+
+thread_local LogCallsite* LogCallsite::_current = 0;
+
+const int64_t LogCallsite::QuietPeriod;
+
+LogCallsite::LogCallsite(const char* file, int line, double linesPerSecond, unsigned int burst) :
+	_file(file),
+	_line(line),
+	_interval(linesPerSecond > 0 ? int64_t(1e9/linesPerSecond) : 0),
+	_tolerance(_interval*(burst > 0 ? burst - 1 : 0)),
+	_full(0),
+	_suppressed(0),
+	_lastHash(0),
+	_repeats(0),
+	_lastLine(0),
+	_out(0) {
+
+	// allow at least one line per 292 years
+	if (linesPerSecond > 0 && _interval == 0)
+		_interval = 1;
+}
+
+LogCallsite::~LogCallsite() {
+
+	// the channel of the logger was constructed before this static object,
+	// and is still alive
+	Logger* out = _out.load(std::memory_order_relaxed);
+
+	if (!out)
+		return;
+
+	reportSuppressed(*out);
+	reportRepeated(*out);
+}
+
+bool
+LogCallsite::repeated(const char* data, size_t size, uint64_t& repeats) {
+
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ (unsigned char)data[i])*1099511628211ULL;
+
+	// 0 marks "no line yet"
+	if (hash == 0)
+		hash = 1;
+
+	if (_lastHash.exchange(hash, std::memory_order_relaxed) == hash) {
+
+		_repeats.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	repeats = _repeats.exchange(0, std::memory_order_relaxed);
+
+	return false;
+}
+
+void
+LogCallsite::reportSuppressed(Logger& out) {
+
+	uint64_t suppressed = _suppressed.exchange(0, std::memory_order_relaxed);
+
+	if (suppressed > 0)
+		out << suppressed << " messages suppressed by the rate limit of " << _file << ":" << _line << std::endl;
+}
+
+void
+LogCallsite::reportRepeated(Logger& out) {
+
+	uint64_t repeats = _repeats.exchange(0, std::memory_order_relaxed);
+
+	// the next line is written even if it equals the last one
+	_lastHash.store(0, std::memory_order_relaxed);
+
+	if (repeats > 0)
+		out << "last message of " << _file << ":" << _line << " repeated " << repeats << " times" << std::endl;
+}
+
+} // namespace logger
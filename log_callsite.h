@@ -0,0 +1,146 @@
+#ifndef UTIL_LOG_CALLSITE_H__
+#define UTIL_LOG_CALLSITE_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace logger {
+
+// forward declaration
+class Logger;
+
+/**
+ * The state of one rate limited log statement (see LOG_ERROR_LIMITED), kept
+ * in a static object at the statement.
+ *
+ * Lines pass a token bucket that allows linesPerSecond lines on average and
+ * bursts of up to burst lines. The number of lines that did not pass is
+ * reported with the next line that does. In addition, a line that is equal to
+ * the previous line of the statement is not written, and a run of equal lines
+ * is reported as "last message repeated N times" before the next different
+ * line, before the next line after a quiet period of a second, or at exit.
+ */
+class LogCallsite {
+
+public:
+
+	/**
+	 * Create the state of a log statement. A linesPerSecond of 0 disables the
+	 * rate limit, such that only repeated lines are collapsed.
+	 */
+	LogCallsite(const char* file, int line, double linesPerSecond, unsigned int burst);
+
+	/**
+	 * Report the pending suppressed and repeated lines.
+	 */
+	~LogCallsite();
+
+	// the time without lines after which pending repeats are reported, in ns
+	static const int64_t QuietPeriod = 1000000000;
+
+	/**
+	 * Called before a line of this statement is composed on out. Returns false
+	 * if the line exceeds the rate limit.
+	 */
+	bool enter(Logger& out) {
+
+		int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+
+		if (!take(now)) {
+
+			_suppressed.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		if (_suppressed.load(std::memory_order_relaxed) > 0)
+			reportSuppressed(out);
+
+		// a run of repeated lines ended a while ago
+		if (_repeats.load(std::memory_order_relaxed) > 0 &&
+		    now - _lastLine.load(std::memory_order_relaxed) >= QuietPeriod)
+			reportRepeated(out);
+
+		_lastLine.store(now, std::memory_order_relaxed);
+		_out.store(&out, std::memory_order_relaxed);
+
+		_current = this;
+
+		return true;
+	}
+
+	/**
+	 * Get and reset the statement the current thread composes a line for, if
+	 * any. Called by Logger at the end of a line.
+	 */
+	static LogCallsite* leave() {
+
+		LogCallsite* site = _current;
+		_current = 0;
+
+		return site;
+	}
+
+	/**
+	 * Check whether the given line equals the previous line of this
+	 * statement, in which case it should not be written. Otherwise, repeats
+	 * is set to the number of lines that were not written since the last
+	 * different line.
+	 */
+	bool repeated(const char* data, size_t size, uint64_t& repeats);
+
+private:
+
+	// take a token from the bucket at time now
+	bool take(int64_t now) {
+
+		if (_interval == 0)
+			return true;
+
+		// the time at which the bucket would be full again
+		int64_t full = _full.load(std::memory_order_relaxed);
+
+		while (true) {
+
+			int64_t start = (full > now ? full : now);
+
+			if (start - now > _tolerance)
+				return false;
+
+			if (_full.compare_exchange_weak(full, start + _interval, std::memory_order_relaxed))
+				return true;
+		}
+	}
+
+	void reportSuppressed(Logger& out);
+
+	// write the pending repeats and start a new run
+	void reportRepeated(Logger& out);
+
+	const char* _file;
+	int         _line;
+
+	// the time between two lines and the time a burst can be ahead, in ns
+	int64_t _interval;
+	int64_t _tolerance;
+
+	std::atomic<int64_t>  _full;
+	std::atomic<uint64_t> _suppressed;
+
+	// the hash of the last line and the number of times it was repeated
+	std::atomic<uint64_t> _lastHash;
+	std::atomic<uint64_t> _repeats;
+
+	// the time of the last line that passed the bucket, in ns
+	std::atomic<int64_t> _lastLine;
+
+	// the logger of the last line, for the reports at exit
+	std::atomic<Logger*> _out;
+
+	static thread_local LogCallsite* _current;
+};
+
+} // namespace logger
+
+#endif // UTIL_LOG_CALLSITE_H__
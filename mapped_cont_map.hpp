@@ -0,0 +1,296 @@
+#ifndef UTIL_MAPPED_CONT_MAP_H__
+#define UTIL_MAPPED_CONT_MAP_H__
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cont_map.hpp"
+#include "exceptions.h"
+
+/*
+ * On-disk format for cont_map with trivially copyable keys and values:
+ *
+ *   cont_map_file_header
+ *   padding up to header.data_offset
+ *   header.num_slots slots of std::pair<Key, T>
+ *
+ * The slots are a verbatim copy of cont_map's internal slots, i.e., keys of
+ * invalid slots point to the next valid slot. This allows mapped_cont_map to
+ * use the file content as it is, without any parsing on startup.
+ */
+
+namespace util {
+
+struct cont_map_file_header {
+
+	char     magic[8];
+	uint32_t version;
+	uint32_t key_size;
+	uint32_t value_size;
+	uint32_t slot_size;
+	uint64_t num_slots;
+	uint64_t size;
+	uint64_t data_offset;
+};
+
+namespace detail {
+
+static const char     ContMapFileMagic[8]   = { 'U', 'T', 'I', 'L', 'C', 'M', 'A', 'P' };
+static const uint32_t ContMapFileVersion    = 1;
+static const uint64_t ContMapFileDataOffset = 64;
+
+} // namespace detail
+
+/**
+ * Write a cont_map to a file that can be opened with mapped_cont_map.
+ */
+template <typename Key, typename T, typename NumConverter, typename Alloc>
+void write_cont_map(const cont_map<Key, T, NumConverter, Alloc>& map, const std::string& filename) {
+
+	static_assert(std::is_trivially_copyable<Key>::value, "write_cont_map needs a trivially copyable key type");
+	static_assert(std::is_trivially_copyable<T>::value,   "write_cont_map needs a trivially copyable value type");
+
+	typedef typename cont_map<Key, T, NumConverter, Alloc>::value_type value_type;
+
+	cont_map_file_header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, detail::ContMapFileMagic, sizeof(header.magic));
+	header.version     = detail::ContMapFileVersion;
+	header.key_size    = sizeof(Key);
+	header.value_size  = sizeof(T);
+	header.slot_size   = sizeof(value_type);
+	header.num_slots   = map.num_slots();
+	header.size        = map.size();
+	header.data_offset = detail::ContMapFileDataOffset;
+
+	std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+
+	if (!out)
+		UTIL_THROW_EXCEPTION(IOError, "can not open " << filename << " for writing");
+
+	char padding[detail::ContMapFileDataOffset - sizeof(header)];
+	std::memset(padding, 0, sizeof(padding));
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(padding, sizeof(padding));
+	out.write(reinterpret_cast<const char*>(map.data()), map.num_slots()*sizeof(value_type));
+
+	if (!out)
+		UTIL_THROW_EXCEPTION(IOError, "writing to " << filename << " failed");
+}
+
+/**
+ * A read-only view on a cont_map file written by write_cont_map. The file is
+ * memory mapped, such that opening takes constant time and several processes
+ * share the same pages through the page cache. Iterating over a corrupt file
+ * throws IOError.
+ */
+template <
+		typename Key,
+		typename T,
+		typename NumConverter = identity<Key> >
+class mapped_cont_map {
+
+public:
+
+	typedef Key                                key_type;
+	typedef T                                  mapped_type;
+	typedef std::pair<Key, T>                  value_type;
+	typedef typename NumConverter::TargetType  num_key_type;
+	typedef std::size_t                        size_type;
+
+	class const_iterator {
+
+	public:
+
+		typedef std::forward_iterator_tag iterator_category;
+		typedef std::pair<Key, T>         value_type;
+		typedef std::ptrdiff_t            difference_type;
+		typedef const std::pair<Key, T>*  pointer;
+		typedef const std::pair<Key, T>&  reference;
+
+		const_iterator(const mapped_cont_map& map, num_key_type i) :
+			_map(&map),
+			_i(i) {
+
+			skip_invalids();
+		}
+
+		reference operator*()  const { return _map->_slots[_i]; }
+		pointer   operator->() const { return &_map->_slots[_i]; }
+
+		const_iterator  operator++(int) { const_iterator p = *this; ++(*this); return p; }
+		const_iterator& operator++()    { _i++; skip_invalids(); return *this; }
+
+		bool operator==(const const_iterator& other) const { return _i == other._i; }
+		bool operator!=(const const_iterator& other) const { return _i != other._i; }
+
+		inline num_key_type index() const { return _i; }
+
+	private:
+
+		void skip_invalids() {
+
+			if (_i >= static_cast<num_key_type>(_map->_numSlots)) {
+
+				_i = _map->_numSlots;
+				return;
+			}
+
+			// keys of invalid elements point to the next valid one, keys of
+			// valid elements to themselves
+			num_key_type next = _map->_converter(_map->_slots[_i].first);
+
+			// do not follow a corrupt file out of the slots or backwards
+			if (next < _i || next > static_cast<num_key_type>(_map->_numSlots))
+				UTIL_THROW_EXCEPTION(IOError, "corrupt cont_map file, slot " << _i << " points to " << next);
+
+			_i = next;
+		}
+
+		const mapped_cont_map* _map;
+		num_key_type           _i;
+	};
+
+	typedef const_iterator iterator;
+
+	/**
+	 * Open a file written by write_cont_map. Throws IOError if the file can
+	 * not be read or was written for different key or value types.
+	 */
+	mapped_cont_map(const std::string& filename, const NumConverter& converter = NumConverter()) :
+		_mapping(0),
+		_length(0),
+		_slots(0),
+		_numSlots(0),
+		_size(0),
+		_converter(converter) {
+
+		static_assert(std::is_trivially_copyable<Key>::value, "mapped_cont_map needs a trivially copyable key type");
+		static_assert(std::is_trivially_copyable<T>::value,   "mapped_cont_map needs a trivially copyable value type");
+
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+			UTIL_THROW_EXCEPTION(IOError, "can not open " << filename);
+
+		struct stat st;
+		if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(cont_map_file_header))) {
+
+			::close(fd);
+			UTIL_THROW_EXCEPTION(IOError, filename << " is not a cont_map file");
+		}
+
+		_length  = st.st_size;
+		_mapping = ::mmap(0, _length, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+
+		if (_mapping == MAP_FAILED) {
+
+			_mapping = 0;
+			UTIL_THROW_EXCEPTION(IOError, "can not map " << filename);
+		}
+
+		const cont_map_file_header& header = *static_cast<const cont_map_file_header*>(_mapping);
+
+		if (std::memcmp(header.magic, detail::ContMapFileMagic, sizeof(header.magic)) != 0 ||
+		    header.version != detail::ContMapFileVersion) {
+
+			unmap();
+			UTIL_THROW_EXCEPTION(IOError, filename << " is not a cont_map file");
+		}
+
+		// the slots have to be within the file, checked without overflows for
+		// corrupt headers
+		if (header.key_size   != sizeof(Key) ||
+		    header.value_size != sizeof(T) ||
+		    header.slot_size  != sizeof(value_type) ||
+		    header.data_offset > _length ||
+		    header.num_slots > (_length - header.data_offset)/sizeof(value_type)) {
+
+			unmap();
+			UTIL_THROW_EXCEPTION(IOError, filename << " does not match the key and value types of this mapped_cont_map");
+		}
+
+		_slots    = reinterpret_cast<const value_type*>(static_cast<const char*>(_mapping) + header.data_offset);
+		_numSlots = header.num_slots;
+		_size     = header.size;
+	}
+
+	~mapped_cont_map() {
+
+		unmap();
+	}
+
+	mapped_cont_map(const mapped_cont_map&) = delete;
+	mapped_cont_map& operator=(const mapped_cont_map&) = delete;
+
+	// iterators
+	const_iterator begin() const { return const_iterator(*this, 0); }
+	const_iterator end() const { return const_iterator(*this, _numSlots); }
+
+	// capacity
+	bool empty() const { return _size == 0; }
+	size_type size() const { return _size; }
+
+	double overhead() const { return (double)_numSlots/size(); }
+
+	// element access
+	const mapped_type& operator[](const key_type& key) const { return at(key); }
+
+	const mapped_type& at(const key_type& key) const {
+
+		if (!count(key))
+			throw std::out_of_range("util::mapped_cont_map::at");
+
+		return _slots[_converter(key)].second;
+	}
+
+	// operations
+	const_iterator find(const key_type& key) const {
+		if (count(key))
+			return const_iterator(*this, _converter(key));
+		return end();
+	}
+
+	size_type count(const key_type& key) const {
+		num_key_type k = _converter(key);
+		return k >= 0 && k < static_cast<num_key_type>(_numSlots) && _converter(_slots[k].first) == k;
+	}
+
+	const_iterator lower_bound(const key_type& key) const {
+		num_key_type k = _converter(key);
+		// negative keys are smaller than all keys of the map
+		return const_iterator(*this, k < 0 ? 0 : k);
+	}
+
+private:
+
+	void unmap() {
+
+		if (_mapping)
+			::munmap(_mapping, _length);
+
+		_mapping = 0;
+	}
+
+	void*             _mapping;
+	size_type         _length;
+	const value_type* _slots;
+	size_type         _numSlots;
+	size_type         _size;
+	NumConverter      _converter;
+};
+
+} // namespace util
+
+#endif // UTIL_MAPPED_CONT_MAP_H__
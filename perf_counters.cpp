@@ -0,0 +1,127 @@
+#include <config.h>
+#include <cerrno>
+#include <cstring>
+#include "perf_counters.h"
+
+#if defined(SYSTEM_UNIX) && !defined(SYSTEM_MAC)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+PerfCounters::PerfCounters() {
+
+	for (int i = 0; i < NumCounters; i++)
+		_fds[i] = -1;
+
+#if defined(SYSTEM_UNIX) && !defined(SYSTEM_MAC)
+
+	static const uint64_t configs[NumCounters] = {
+
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+
+	for (int i = 0; i < NumCounters; i++) {
+
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size           = sizeof(attr);
+		attr.type           = PERF_TYPE_HARDWARE;
+		attr.config         = configs[i];
+		attr.read_format    = PERF_FORMAT_GROUP;
+		attr.disabled       = (i == 0);
+		attr.exclude_kernel = 1;
+		attr.exclude_hv     = 1;
+
+		// the first counter is the group leader
+		_fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, (i == 0 ? -1 : _fds[0]), 0);
+
+		if (_fds[i] < 0) {
+
+			_error = std::string("can not open counter for ") + getName(static_cast<Counter>(i)) + ": " + std::strerror(errno);
+			close();
+			return;
+		}
+	}
+
+	ioctl(_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+#else
+
+	_error = "hardware counters are only supported on Linux";
+
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+
+	close();
+}
+
+bool
+PerfCounters::read(uint64_t values[NumCounters]) const {
+
+#if defined(SYSTEM_UNIX) && !defined(SYSTEM_MAC)
+
+	if (!isAvailable())
+		return false;
+
+	// PERF_FORMAT_GROUP: the number of counters, followed by their values
+	uint64_t buffer[1 + NumCounters];
+
+	if (::read(_fds[0], buffer, sizeof(buffer)) != sizeof(buffer) || buffer[0] != NumCounters)
+		return false;
+
+	for (int i = 0; i < NumCounters; i++)
+		values[i] = buffer[1 + i];
+
+	return true;
+
+#else
+
+	return false;
+
+#endif
+}
+
+PerfCounters&
+PerfCounters::threadCounters() {
+
+	thread_local PerfCounters counters;
+
+	return counters;
+}
+
+const char*
+PerfCounters::getName(Counter counter) {
+
+	switch (counter) {
+
+		case Cycles:       return "cycles";
+		case Instructions: return "instructions";
+		case CacheMisses:  return "cache misses";
+		case BranchMisses: return "branch misses";
+		default:           return "unknown";
+	}
+}
+
+void
+PerfCounters::close() {
+
+#if defined(SYSTEM_UNIX) && !defined(SYSTEM_MAC)
+
+	// close the members before the leader
+	for (int i = NumCounters - 1; i >= 0; i--)
+		if (_fds[i] >= 0)
+			::close(_fds[i]);
+
+#endif
+
+	for (int i = 0; i < NumCounters; i++)
+		_fds[i] = -1;
+}
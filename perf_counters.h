@@ -0,0 +1,73 @@
+#ifndef UTIL_PERF_COUNTERS_H__
+#define UTIL_PERF_COUNTERS_H__
+
+#include <cstdint>
+#include <string>
+
+/**
+ * A group of hardware performance counters of the current thread, read with
+ * perf_event_open (Linux only).
+ *
+ * The counters (cycles, instructions, cache misses, and branch misses) are
+ * opened as one group, such that they are scheduled together and can be read
+ * with a single system call. Only user space events of the calling thread are
+ * counted. If the counters can not be opened (e.g., on other systems, in
+ * virtual machines without a PMU, or if /proc/sys/kernel/perf_event_paranoid
+ * forbids it), isAvailable() returns false and read() fails.
+ */
+class PerfCounters {
+
+public:
+
+	enum Counter {
+
+		Cycles,
+		Instructions,
+		CacheMisses,
+		BranchMisses,
+		NumCounters
+	};
+
+	/**
+	 * Open the counters for the current thread.
+	 */
+	PerfCounters();
+
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	/**
+	 * True, if the counters were opened successfully.
+	 */
+	bool isAvailable() const { return _fds[0] >= 0; }
+
+	/**
+	 * The reason why the counters are not available.
+	 */
+	const std::string& getError() const { return _error; }
+
+	/**
+	 * Read the current values of all counters. Returns false if the counters
+	 * are not available.
+	 */
+	bool read(uint64_t values[NumCounters]) const;
+
+	/**
+	 * The counters of the calling thread, opened on the first call.
+	 */
+	static PerfCounters& threadCounters();
+
+	static const char* getName(Counter counter);
+
+private:
+
+	void close();
+
+	int _fds[NumCounters];
+
+	std::string _error;
+};
+
+#endif // UTIL_PERF_COUNTERS_H__
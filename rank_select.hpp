@@ -0,0 +1,197 @@
+#ifndef UTIL_RANK_SELECT_H__
+#define UTIL_RANK_SELECT_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/**
+ * A dynamic bit vector with rank and select support.
+ *
+ * Bits are packed into 64-bit words. The number of set bits per word is kept
+ * in a Fenwick tree (binary indexed tree), such that setting or resetting a
+ * bit, rank (the number of set bits before a position) and select (the
+ * position of the n-th set bit) all take O(log n). Within a word, counting and
+ * selecting is done with popcount.
+ */
+class rank_select {
+
+public:
+
+	typedef std::size_t size_type;
+
+	rank_select() : _size(0), _ones(0) {}
+
+	/**
+	 * Set the number of bits. New bits are unset.
+	 */
+	void resize(size_type size) {
+
+		size_type words = (size + 63)/64;
+
+		// clear bits that fall off the end
+		if (size < _size) {
+
+			for (size_type i = size; i < _size && i < words*64; i++)
+				reset(i);
+			for (size_type w = words; w < _words.size(); w++)
+				while (_words[w])
+					reset(w*64 + __builtin_ctzll(_words[w]));
+		}
+
+		_size = size;
+
+		if (words > _tree.size()) {
+
+			_words.resize(words, 0);
+
+			// grow geometrically, the tree has to be rebuilt on growth
+			size_type capacity = (_tree.size() ? _tree.size() : 1);
+			while (capacity < words)
+				capacity *= 2;
+			_words.resize(capacity, 0);
+			rebuild(capacity);
+
+		} else {
+
+			_words.resize(std::max(words, _words.size()), 0);
+		}
+	}
+
+	size_type size() const { return _size; }
+
+	/**
+	 * The total number of set bits.
+	 */
+	size_type count() const { return _ones; }
+
+	bool test(size_type i) const { return _words[i/64] & (uint64_t(1) << (i%64)); }
+
+	void set(size_type i) {
+
+		if (test(i))
+			return;
+
+		_words[i/64] |= uint64_t(1) << (i%64);
+		update(i/64, 1);
+		_ones++;
+	}
+
+	void reset(size_type i) {
+
+		if (!test(i))
+			return;
+
+		_words[i/64] &= ~(uint64_t(1) << (i%64));
+		update(i/64, -1);
+		_ones--;
+	}
+
+	void clear() {
+
+		_words.clear();
+		_tree.clear();
+		_size = 0;
+		_ones = 0;
+	}
+
+	void swap(rank_select& other) {
+
+		_words.swap(other._words);
+		_tree.swap(other._tree);
+		std::swap(_size, other._size);
+		std::swap(_ones, other._ones);
+	}
+
+	/**
+	 * The number of set bits in [0, i).
+	 */
+	size_type rank(size_type i) const {
+
+		if (i >= _size)
+			return _ones;
+
+		size_type w = i/64;
+		size_type r = prefix(w);
+
+		if (i%64)
+			r += __builtin_popcountll(_words[w] & ((uint64_t(1) << (i%64)) - 1));
+
+		return r;
+	}
+
+	/**
+	 * The position of the n-th (starting with 0) set bit, or size() if there
+	 * are not more than n set bits.
+	 */
+	size_type select(size_type n) const {
+
+		if (n >= _ones)
+			return _size;
+
+		// descend the Fenwick tree to find the word containing the bit
+		size_type w = 0;
+		size_type step = _tree.size();
+		while (step & (step - 1))
+			step &= step - 1;
+
+		for (; step > 0; step /= 2)
+			if (w + step <= _tree.size() && _tree[w + step - 1] <= n) {
+
+				w += step;
+				n -= _tree[w - 1];
+			}
+
+		// select within the word
+		uint64_t bits = _words[w];
+		for (; n > 0; n--)
+			bits &= bits - 1;
+
+		return w*64 + __builtin_ctzll(bits);
+	}
+
+private:
+
+	// the number of set bits in words [0, w)
+	size_type prefix(size_type w) const {
+
+		size_type sum = 0;
+		for (; w > 0; w &= w - 1)
+			sum += _tree[w - 1];
+
+		return sum;
+	}
+
+	void update(size_type w, int delta) {
+
+		for (w++; w <= _tree.size(); w += w & -w)
+			_tree[w - 1] += delta;
+	}
+
+	void rebuild(size_type capacity) {
+
+		_tree.assign(capacity, 0);
+
+		for (size_type w = 1; w <= capacity; w++) {
+
+			_tree[w - 1] += __builtin_popcountll(_words[w - 1]);
+
+			size_type parent = w + (w & -w);
+			if (parent <= capacity)
+				_tree[parent - 1] += _tree[w - 1];
+		}
+	}
+
+	std::vector<uint64_t>  _words;
+	std::vector<size_type> _tree;
+
+	size_type _size;
+	size_type _ones;
+};
+
+} // namespace util
+
+#endif // UTIL_RANK_SELECT_H__
@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+#include "rotating_file_buffer.h"
+
+namespace logger {
+
+/**
+ * Periodically writes the buffers of all RotatingFileBuffers to their files
+ * and rotates files that are too old.
+ */
+class RotatingFileBuffer::Flusher {
+
+public:
+
+	static void add(RotatingFileBuffer* buffer, std::chrono::milliseconds interval) {
+
+		State& s = state();
+
+		std::lock_guard<std::mutex> lock(s.mutex);
+
+		s.buffers.push_back(buffer);
+
+		if (s.buffers.size() == 1 || interval < s.interval)
+			s.interval = interval;
+
+		if (s.thread.joinable())
+			return;
+
+		s.stop   = false;
+		s.thread = std::thread(run);
+
+		// stop before the buffers are destructed
+		static bool registered = false;
+		if (!registered) {
+
+			std::atexit(stop);
+			registered = true;
+		}
+	}
+
+	static void remove(RotatingFileBuffer* buffer) {
+
+		State& s = state();
+
+		std::lock_guard<std::mutex> lock(s.mutex);
+
+		s.buffers.erase(std::remove(s.buffers.begin(), s.buffers.end(), buffer), s.buffers.end());
+	}
+
+	static void stop() {
+
+		State& s = state();
+
+		{
+			std::lock_guard<std::mutex> lock(s.mutex);
+			s.stop = true;
+		}
+		s.wakeup.notify_one();
+
+		if (s.thread.joinable())
+			s.thread.join();
+	}
+
+private:
+
+	struct State {
+
+		State() : interval(1000), stop(false) {}
+
+		std::vector<RotatingFileBuffer*> buffers;
+		std::chrono::milliseconds        interval;
+		bool                             stop;
+		std::mutex                       mutex;
+		std::condition_variable          wakeup;
+		std::thread                      thread;
+	};
+
+	// never destructed, such that buffers can be removed during the
+	// destruction of static objects
+	static State& state() {
+
+		static State* s = new State();
+
+		return *s;
+	}
+
+	static void run() {
+
+		State& s = state();
+
+		std::unique_lock<std::mutex> lock(s.mutex);
+
+		while (!s.stop) {
+
+			s.wakeup.wait_for(lock, s.interval);
+
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+			for (size_t i = 0; i < s.buffers.size(); i++)
+				s.buffers[i]->tick(now);
+		}
+	}
+};
+
+RotatingFileBuffer::RotatingFileBuffer(
+		const std::string&        filename,
+		size_t                    maxSize,
+		std::chrono::seconds      maxAge,
+		unsigned int              maxFiles,
+		size_t                    bufferSize,
+		std::chrono::milliseconds flushInterval) :
+	_filename(filename),
+	_maxSize(maxSize),
+	_maxFiles(std::max(maxFiles, 1u)),
+	_maxAge(maxAge),
+	_file(0),
+	_fileSize(0),
+	_buffer(std::max(bufferSize, size_t(1))),
+	_used(0) {
+
+	if (!open())
+		return;
+
+	Flusher::add(this, flushInterval);
+}
+
+RotatingFileBuffer::~RotatingFileBuffer() {
+
+	Flusher::remove(this);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	writeBuffer();
+
+	if (_file)
+		std::fclose(_file);
+}
+
+void
+RotatingFileBuffer::flush() {
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	writeBuffer();
+}
+
+void
+RotatingFileBuffer::flushNow(std::streambuf* target) {
+
+	if (RotatingFileBuffer* buffer = dynamic_cast<RotatingFileBuffer*>(target))
+		buffer->flush();
+	else if (target)
+		target->pubsync();
+}
+
+RotatingFileBuffer::int_type
+RotatingFileBuffer::overflow(int_type c) {
+
+	if (!traits_type::eq_int_type(c, traits_type::eof())) {
+
+		char ch = traits_type::to_char_type(c);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		append(&ch, 1);
+	}
+
+	return traits_type::not_eof(c);
+}
+
+std::streamsize
+RotatingFileBuffer::xsputn(const char* s, std::streamsize n) {
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	append(s, n);
+
+	return n;
+}
+
+int
+RotatingFileBuffer::sync() {
+
+	return 0;
+}
+
+void
+RotatingFileBuffer::tick(std::chrono::steady_clock::time_point now) {
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// the file could not be opened at the last rotation, try again
+	if (!isOpen()) {
+
+		open();
+		return;
+	}
+
+	if (_maxAge.count() > 0 && now - _opened >= _maxAge && _fileSize + _used > 0)
+		rotate();
+	else
+		writeBuffer();
+}
+
+void
+RotatingFileBuffer::append(const char* s, size_t n) {
+
+	if (!isOpen())
+		return;
+
+	// start a new file before this line, unless it is the first line of the
+	// current file
+	if (_maxSize > 0 && _fileSize + _used + n > _maxSize && _fileSize + _used > 0) {
+
+		rotate();
+
+		if (!isOpen())
+			return;
+	}
+
+	if (_used + n > _buffer.size()) {
+
+		writeBuffer();
+
+		// write lines larger than the buffer directly
+		if (n > _buffer.size()) {
+
+			_fileSize += std::fwrite(s, 1, n, _file);
+			return;
+		}
+	}
+
+	std::copy(s, s + n, _buffer.begin() + _used);
+	_used += n;
+}
+
+void
+RotatingFileBuffer::writeBuffer() {
+
+	if (!isOpen() || _used == 0)
+		return;
+
+	_fileSize += std::fwrite(&_buffer[0], 1, _used, _file);
+	_used = 0;
+}
+
+bool
+RotatingFileBuffer::open() {
+
+	// also if the file can not be opened, such that the limits are not
+	// exceeded again before a retry
+	_fileSize = 0;
+	_opened   = std::chrono::steady_clock::now();
+
+	_file = std::fopen(_filename.c_str(), "w");
+
+	if (!_file)
+		return false;
+
+	// we do the buffering
+	std::setvbuf(_file, 0, _IONBF, 0);
+
+	return true;
+}
+
+void
+RotatingFileBuffer::rotate() {
+
+	if (!isOpen())
+		return;
+
+	writeBuffer();
+	std::fclose(_file);
+	_file = 0;
+
+	if (_maxFiles > 1) {
+
+		std::remove(rotatedName(_maxFiles - 1).c_str());
+
+		for (unsigned int i = _maxFiles - 1; i > 1; i--)
+			std::rename(rotatedName(i - 1).c_str(), rotatedName(i).c_str());
+
+		std::rename(_filename.c_str(), rotatedName(1).c_str());
+	}
+
+	// if the file can not be opened, the following lines are discarded until
+	// the flusher succeeds to open it
+	open();
+}
+
+std::string
+RotatingFileBuffer::rotatedName(unsigned int i) const {
+
+	std::stringstream name;
+	name << _filename << "." << i;
+
+	return name.str();
+}
+
+} // namespace logger
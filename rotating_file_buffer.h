@@ -0,0 +1,105 @@
+#ifndef UTIL_ROTATING_FILE_BUFFER_H__
+#define UTIL_ROTATING_FILE_BUFFER_H__
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace logger {
+
+/**
+ * A stream buffer for log files, which collects lines in a large buffer and
+ * writes them to the file only if the buffer is full, periodically from a
+ * background thread (every flush interval), or immediately for error messages
+ * (see flushNow()). sync() does not write, such that a std::endl per line does
+ * not cost a system call.
+ *
+ * The file is rotated if it would grow beyond maxSize bytes or if it is older
+ * than maxAge: the current file is renamed to <filename>.1, a previous
+ * <filename>.1 to <filename>.2, and so on, keeping at most maxFiles files
+ * (including the current one). A limit of 0 disables the rotation by size or
+ * age. Lines are never split between files. If a new file can not be opened,
+ * lines are discarded until the background thread succeeds to open it.
+ */
+class RotatingFileBuffer : public std::streambuf {
+
+public:
+
+	RotatingFileBuffer(
+			const std::string&        filename,
+			size_t                    maxSize,
+			std::chrono::seconds      maxAge,
+			unsigned int              maxFiles,
+			size_t                    bufferSize,
+			std::chrono::milliseconds flushInterval);
+
+	~RotatingFileBuffer();
+
+	bool isOpen() const { return _file != 0; }
+
+	/**
+	 * Write the buffered lines to the file.
+	 */
+	void flush();
+
+	/**
+	 * Write the lines of the given stream buffer to their destination now. If
+	 * target is a RotatingFileBuffer, its buffer is written to the file,
+	 * otherwise target is synced.
+	 */
+	static void flushNow(std::streambuf* target);
+
+protected:
+
+	int_type overflow(int_type c);
+
+	std::streamsize xsputn(const char* s, std::streamsize n);
+
+	// does not write, the buffer is written by the flusher thread
+	int sync();
+
+private:
+
+	// called by the flusher thread
+	void tick(std::chrono::steady_clock::time_point now);
+
+	// the following expect _mutex to be locked
+
+	void append(const char* s, size_t n);
+
+	void writeBuffer();
+
+	bool open();
+
+	void rotate();
+
+	std::string rotatedName(unsigned int i) const;
+
+	std::string  _filename;
+	size_t       _maxSize;
+	unsigned int _maxFiles;
+
+	std::chrono::steady_clock::duration _maxAge;
+
+	std::mutex _mutex;
+
+	std::FILE* _file;
+
+	// the bytes written to the current file so far
+	size_t _fileSize;
+
+	std::chrono::steady_clock::time_point _opened;
+
+	std::vector<char> _buffer;
+	size_t            _used;
+
+	// the background thread that flushes and rotates all RotatingFileBuffers
+	class Flusher;
+};
+
+} // namespace logger
+
+#endif // UTIL_ROTATING_FILE_BUFFER_H__
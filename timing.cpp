@@ -1,87 +1,1650 @@
 #include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
-#include <boost/chrono.hpp>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include "Logger.h"
+#include "ProgramOptions.h"
+#include "exceptions.h"
 #include "timing.h"
 
+util::ProgramOption optionTiming(
+		util::_module = "Timing",
+		util::_long_name = "timing",
+		util::_description_text =
+		"Enable the timing of scopes (default). Use --timing=false to disable "
+		"all timers, such that each timed scope costs a single branch.",
+		util::_default_value = true);
+
+util::ProgramOption optionTimingPrefixes(
+		util::_module = "Timing",
+		util::_long_name = "timing-prefixes",
+		util::_description_text =
+		"A comma-separated list of identifier prefixes. If given, only scopes "
+		"whose identifiers start with one of the prefixes are timed.",
+		util::_argument_sketch = "prefixes");
+
+util::ProgramOption optionTimingSample(
+		util::_module = "Timing",
+		util::_long_name = "timing-sample",
+		util::_description_text =
+		"Record only every n-th run of each timed scope (per thread). The "
+		"summary then reports the sampled runs only, and the nesting in the "
+		"call tree is approximate.",
+		util::_argument_sketch = "n",
+		util::_default_value = 1);
+
+util::ProgramOption optionTimingCounters(
+		util::_module = "Timing",
+		util::_long_name = "timing-counters",
+		util::_description_text =
+		"Read the hardware performance counters (cycles, instructions, cache "
+		"misses, branch misses) in each timed scope and show the instructions "
+		"per cycle and misses per run in the summary. Linux only, ignored with "
+		"a warning if the counters are not available.");
+
+util::ProgramOption optionTimingAllocations(
+		util::_module = "Timing",
+		util::_long_name = "timing-allocations",
+		util::_description_text =
+		"Count the heap allocations in each timed scope and show the "
+		"allocations and allocated bytes per run and the peak of live bytes in "
+		"the summary. Needs util to be built with BUILD_UTIL_ALLOCATION_TRACKER, "
+		"ignored with a warning otherwise.");
+
+util::ProgramOption optionTimingClock(
+		util::_module = "Timing",
+		util::_long_name = "timing-clock",
+		util::_description_text =
+		"The clock to use for timing scopes: \"cpu\" (wall time and cpu "
+		"time of the thread, default), \"wall\" (wall time only, cheaper), or "
+		"\"tsc\" (wall time from the CPU's time stamp counter, cheapest).",
+		util::_argument_sketch = "clock");
+
+util::ProgramOption optionTimingCallTree(
+		util::_module = "Timing",
+		util::_long_name = "timing-call-tree",
+		util::_description_text =
+		"Print the call tree of nested timers with inclusive and exclusive "
+		"times after the timing summary, to the same output.");
+
+util::ProgramOption optionTimingTrace(
+		util::_module = "Timing",
+		util::_long_name = "timing-trace",
+		util::_description_text =
+		"Record the begin and end of each timed scope and write them to the "
+		"given file at the end of the program, in the Chrome Trace Event "
+		"format (to be opened with chrome://tracing or Perfetto).",
+		util::_argument_sketch = "file");
+
+util::ProgramOption optionTimingFormat(
+		util::_module = "Timing",
+		util::_long_name = "timing-format",
+		util::_description_text =
+		"The format of the timing summary: \"table\" (default), \"csv\", or "
+		"\"json\".",
+		util::_argument_sketch = "format");
+
+util::ProgramOption optionTimingOutput(
+		util::_module = "Timing",
+		util::_long_name = "timing-output",
+		util::_description_text =
+		"Write the timing summary to the given file instead of the standard "
+		"output.",
+		util::_argument_sketch = "file");
+
+util::ProgramOption optionTimingReportInterval(
+		util::_module = "Timing",
+		util::_long_name = "timing-report-interval",
+		util::_description_text =
+		"Write a timing summary of the last interval every given number of "
+		"seconds, to the file given by --timing-report-file or to the log "
+		"channel timinglog.",
+		util::_argument_sketch = "seconds");
+
+util::ProgramOption optionTimingReportFile(
+		util::_module = "Timing",
+		util::_long_name = "timing-report-file",
+		util::_description_text =
+		"The file to append the interval reports of --timing-report-interval "
+		"to.",
+		util::_argument_sketch = "file");
+
+// declared before _instance, such that it is still alive when _instance
+// writes its last report
+logger::LogChannel timinglog("timinglog", "[Timing] ");
+
 TimingStatistics TimingStatistics::_instance;
 
-float
-Timer::elapsed() const {
+namespace {
+
+// escape a string for a JSON string literal
+std::string jsonEscape(const std::string& s) {
+
+	std::string escaped;
+	for (char c : s) {
+
+		if (c == '"' || c == '\\')
+			escaped += '\\';
+		if (static_cast<unsigned char>(c) < 0x20)
+			escaped += ' ';
+		else
+			escaped += c;
+	}
+
+	return escaped;
+}
+
+// quote a string for a CSV field
+std::string csvQuote(const std::string& s) {
+
+	std::string quoted("\"");
+	for (char c : s) {
+
+		if (c == '"')
+			quoted += '"';
+		quoted += c;
+	}
+
+	return quoted + "\"";
+}
+
+// the name of a metric kind, 0 for timers
+const char* kindName(unsigned char kind) {
+
+	switch (kind) {
+
+		case TimingStatistics::Counter:
+			return "counter";
+
+		case TimingStatistics::Gauge:
+			return "gauge";
+
+		default:
+			return "timer";
+	}
+}
+
+// set when the ThreadTimes of this thread were destructed, metrics of this
+// thread are dropped from then on
+thread_local bool threadTimesReleased = false;
+
+} // anonymous namespace
+
+Timer::Clock Timer::_clockSource = Timer::Cpu;
+
+bool TimingStatistics::_traceEnabled = false;
+
+std::atomic<bool> TimingStatistics::_enabled(true);
+
+bool TimingStatistics::_countersEnabled = false;
+
+bool TimingStatistics::_allocationsEnabled = false;
+
+thread_local Timer* Timer::_current = 0;
+
+thread_local TimingStatistics::ThreadMetrics* TimingStatistics::_threadMetrics = 0;
+
+unsigned int TimingStatistics::_sampling = 1;
+
+const TimerId TimingStatistics::MaxTimerIds;
+const TimerId TimingStatistics::NoTimer;
+
+float
+Timer::elapsed() const {
+
+	uint64_t stop = (_stopped ? _stop : now(_clock));
+
+	if (_clock == Tsc)
+		return (stop - _start)*tscCalibration().secondsPerTick;
+
+	return (stop - _start)*1e-9;
+}
+
+float
+Timer::cpuElapsed() const {
+
+	if (_clock != Cpu)
+		return 0;
+
+	uint64_t stop = (_stopped ? _cpuStop : threadCpuTime());
+
+	return (stop - _cpuStart)*1e-9;
+}
+
+uint64_t
+Timer::startTime() const {
+
+	if (_clock != Tsc)
+		return _start;
+
+	const TscCalibration& calibration = tscCalibration();
+
+	return calibration.nanoseconds + ((double)_start - (double)calibration.ticks)*calibration.secondsPerTick*1e9;
+}
+
+bool
+Timer::counterDeltas(uint64_t deltas[PerfCounters::NumCounters]) const {
+
+	if (!_counters || !_stopped)
+		return false;
+
+	for (int i = 0; i < PerfCounters::NumCounters; i++)
+		deltas[i] = _counterStop[i] - _counterStart[i];
+
+	return true;
+}
+
+bool
+Timer::allocationCounts(uint64_t& allocations, uint64_t& bytes, int64_t& peak) const {
+
+	if (!_allocations || !_stopped)
+		return false;
+
+	allocations = _allocationCount;
+	bytes       = _allocatedBytes;
+	peak        = _peakBytes;
+
+	return true;
+}
+
+void
+Timer::startAllocations() {
+
+	AllocationTracker::Counts& counts = AllocationTracker::threadCounts();
+
+	_allocationsStart = counts;
+	_childAllocations = 0;
+	_childBytes       = 0;
+
+	// track the peak of this timer, the outer peak is restored in
+	// stopAllocations()
+	counts.peak = counts.live;
+
+	_parent  = _current;
+	_current = this;
+}
+
+void
+Timer::stopAllocations() {
+
+	AllocationTracker::Counts& counts = AllocationTracker::threadCounts();
+
+	uint64_t allocations = counts.allocations - _allocationsStart.allocations;
+	uint64_t bytes       = counts.bytes - _allocationsStart.bytes;
+
+	_allocationCount = allocations - _childAllocations;
+	_allocatedBytes  = bytes - _childBytes;
+	_peakBytes       = std::max<int64_t>(0, counts.peak - _allocationsStart.live);
+
+	counts.peak = std::max(counts.peak, _allocationsStart.peak);
+
+	if (_parent) {
+
+		_parent->_childAllocations += allocations;
+		_parent->_childBytes       += bytes;
+	}
+
+	_current = _parent;
+}
+
+Timer::TscCalibration::TscCalibration() {
+
+	// measure the TSC frequency once, over 20ms of steady_clock
+	uint64_t ticksBegin = now(Tsc);
+	uint64_t nsBegin    = now(Wall);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	uint64_t ticksEnd   = now(Tsc);
+	uint64_t nsEnd      = now(Wall);
+
+	ticks          = ticksEnd;
+	nanoseconds    = nsEnd;
+	secondsPerTick = (ticksEnd == ticksBegin ? 1e-9 : (nsEnd - nsBegin)*1e-9/(ticksEnd - ticksBegin));
+}
+
+void
+Timer::setClock(Clock clock) {
+
+	// calibrate now, not during the first timed scope
+	if (clock == Tsc)
+		tscCalibration();
+
+	_clockSource = clock;
+}
+
+const Timer::TscCalibration&
+Timer::tscCalibration() {
+
+	static const TscCalibration calibration;
+
+	return calibration;
+}
+
+void
+TimingStatistics::Statistics::merge(const Statistics& other) {
+
+	wall.merge(other.wall);
+	cpu         += other.cpu;
+	countedRuns += other.countedRuns;
+
+	for (int i = 0; i < PerfCounters::NumCounters; i++)
+		counters[i] += other.counters[i];
+
+	trackedRuns    += other.trackedRuns;
+	allocations    += other.allocations;
+	allocatedBytes += other.allocatedBytes;
+	peakBytes       = std::max(peakBytes, other.peakBytes);
+}
+
+void
+TimingStatistics::Statistics::clear() {
+
+	wall.clear();
+	cpu         = 0;
+	countedRuns = 0;
+
+	std::fill(counters, counters + PerfCounters::NumCounters, 0);
+
+	trackedRuns    = 0;
+	allocations    = 0;
+	allocatedBytes = 0;
+	peakBytes      = 0;
+}
+
+void
+TimingStatistics::CallTreeNode::merge(const CallTreeNode& other) {
+
+	count     += other.count;
+	inclusive += other.inclusive;
+
+	for (const auto& p : other.children)
+		children[p.first].merge(p.second);
+}
+
+void
+TimingStatistics::CallTreeNode::clear() {
+
+	count     = 0;
+	inclusive = 0;
+
+	for (auto& p : children)
+		p.second.clear();
+}
+
+double
+TimingStatistics::CallTreeNode::childTime() const {
+
+	double time = 0;
+	for (const auto& p : children)
+		time += p.second.inclusive;
+
+	return time;
+}
+
+uint64_t
+TimingStatistics::CallTreeNode::totalCount() const {
+
+	uint64_t total = count;
+	for (const auto& p : children)
+		total += p.second.totalCount();
+
+	return total;
+}
+
+TimingStatistics::TimingStatistics() :
+	_nextThreadId(0),
+	_numTimerIds(0),
+	_noTimerIdentifier("(disabled)"),
+	_metricsBegin(std::chrono::steady_clock::now()),
+	_intervalMetricsBegin(_metricsBegin),
+	_format(Table),
+	_collectInterval(false),
+	_stopReporter(false),
+	_reportInterval(0),
+	_showCallTree(false) {
+
+	_identifiers[NoTimer].store(&_noTimerIdentifier, std::memory_order_release);
+}
+
+void
+TimingStatistics::init() {
+
+	if (optionTimingClock) {
+
+		std::string clock = optionTimingClock;
+
+		if (clock == "cpu")
+			Timer::setClock(Timer::Cpu);
+		else if (clock == "wall")
+			Timer::setClock(Timer::Wall);
+		else if (clock == "tsc")
+			Timer::setClock(Timer::Tsc);
+		else
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"invalid value for " << optionTimingClock.getLongParam() << ": " << clock);
+	}
+
+	_instance._showCallTree = optionTimingCallTree;
+
+	if (optionTimingFormat) {
+
+		std::string format = optionTimingFormat;
+
+		if (format == "table")
+			_instance._format = Table;
+		else if (format == "csv")
+			_instance._format = Csv;
+		else if (format == "json")
+			_instance._format = Json;
+		else
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"invalid value for " << optionTimingFormat.getLongParam() << ": " << format);
+	}
+
+	if (optionTimingOutput)
+		_instance._outputFile = optionTimingOutput.as<std::string>();
+
+	if (optionTimingPrefixes) {
+
+		std::vector<std::string> prefixes;
+		std::string list = optionTimingPrefixes;
+
+		std::string::size_type begin = 0;
+		while (begin <= list.size()) {
+
+			std::string::size_type end = std::min(list.find(',', begin), list.size());
+			if (end > begin)
+				prefixes.push_back(list.substr(begin, end - begin));
+			begin = end + 1;
+		}
+
+		setPrefixes(prefixes);
+	}
+
+	int sampling = optionTimingSample;
+	if (sampling < 1)
+		UTIL_THROW_EXCEPTION(
+				UsageError,
+				"invalid value for " << optionTimingSample.getLongParam() << ": " << sampling);
+	setSampling(sampling);
+
+	setEnabled(optionTiming);
+
+	if (optionTimingAllocations && !setAllocationsEnabled(true))
+		LOG_USER(timinglog)
+				<< "allocation tracking is not available, util was built without "
+				<< "BUILD_UTIL_ALLOCATION_TRACKER" << std::endl;
+
+	if (optionTimingCounters && !setCountersEnabled(true))
+		LOG_USER(timinglog)
+				<< "hardware counters are not available, timing only ("
+				<< PerfCounters::threadCounters().getError() << ")" << std::endl;
+
+	if (optionTimingReportInterval) {
+
+		double interval = optionTimingReportInterval;
+		if (interval <= 0)
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"invalid value for " << optionTimingReportInterval.getLongParam() << ": " << interval);
+
+		startReporter(interval, optionTimingReportFile ? optionTimingReportFile.as<std::string>() : std::string());
+	}
+
+	if (optionTimingTrace) {
+
+		_instance._traceFile = optionTimingTrace.as<std::string>();
+		setTraceEnabled(true);
+	}
+}
+
+TimingStatistics::ThreadTimes::ThreadTimes() {
+
+	std::lock_guard<std::mutex> lock(_instance._mutex);
+	_instance._threads.insert(this);
+	id = _instance._nextThreadId++;
+}
+
+TimingStatistics::ThreadTimes::~ThreadTimes() {
+
+	std::lock_guard<std::mutex> lock(_instance._mutex);
+	_instance.merge(*this);
+	_instance._threads.erase(this);
+
+	// keep the metrics of this thread
+	for (TimerId id = 0; id <= MaxTimerIds; id++) {
+
+		ThreadMetric* page = metrics.pages[id >> MetricPageBits].load(std::memory_order_relaxed);
+		if (!page) {
+
+			id |= MetricPageSize - 1;
+			continue;
+		}
+
+		if (id >= _instance._endedThreadMetrics.size())
+			_instance._endedThreadMetrics.resize(id + 1);
+		_instance._endedThreadMetrics[id].add(page[id & (MetricPageSize - 1)]);
+	}
+
+	threadTimesReleased = true;
+	_threadMetrics      = 0;
+}
+
+TimingStatistics::ThreadMetrics::ThreadMetrics() {
+
+	for (auto& page : pages)
+		page.store(0, std::memory_order_relaxed);
+}
+
+TimingStatistics::ThreadMetrics::~ThreadMetrics() {
+
+	for (auto& page : pages)
+		delete[] page.load(std::memory_order_relaxed);
+}
+
+TimingStatistics::ThreadMetric*
+TimingStatistics::ThreadMetrics::addPage(TimerId id) {
+
+	// value-initialized, i.e., all zero
+	ThreadMetric* page = new ThreadMetric[MetricPageSize]();
+
+	// publish the page to collectMetrics() in other threads
+	pages[id >> MetricPageBits].store(page, std::memory_order_release);
+
+	return page;
+}
+
+void
+TimingStatistics::MetricTotals::add(const ThreadMetric& metric) {
+
+	MetricTotals totals;
+	totals.count = metric.count.load(std::memory_order_relaxed);
+	totals.sum   = metric.sum.load(std::memory_order_relaxed);
+	totals.min   = metric.min.load(std::memory_order_relaxed);
+	totals.max   = metric.max.load(std::memory_order_relaxed);
+	totals.last  = metric.last.load(std::memory_order_relaxed);
+	totals.stamp = metric.stamp.load(std::memory_order_relaxed);
+
+	add(totals);
+}
+
+void
+TimingStatistics::MetricTotals::add(const MetricTotals& other) {
+
+	if (other.count == 0)
+		return;
+
+	min = (count ? std::min(min, other.min) : other.min);
+	max = (count ? std::max(max, other.max) : other.max);
+
+	if (other.stamp >= stamp) {
+
+		last  = other.last;
+		stamp = other.stamp;
+	}
+
+	count += other.count;
+	sum   += other.sum;
+}
+
+TimingStatistics::ThreadMetrics*
+TimingStatistics::initThreadMetrics() {
+
+	// called from the destructor of another thread local object, after the
+	// metrics of this thread were merged
+	if (threadTimesReleased)
+		return 0;
+
+	_threadMetrics = &getThreadTimes().metrics;
+
+	return _threadMetrics;
+}
+
+TimingStatistics::ThreadMetric&
+TimingStatistics::discardedMetric() {
+
+	// written to by all threads, but never read
+	static ThreadMetric metric;
+
+	return metric;
+}
+
+void
+TimingStatistics::gauge(TimerId id, double value) {
+
+	ThreadMetric& metric = getThreadMetric(id);
+
+	uint64_t count = metric.count.load(std::memory_order_relaxed);
+
+	if (count == 0 || value < metric.min.load(std::memory_order_relaxed))
+		metric.min.store(value, std::memory_order_relaxed);
+	if (count == 0 || value > metric.max.load(std::memory_order_relaxed))
+		metric.max.store(value, std::memory_order_relaxed);
+
+	uint64_t stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	metric.sum.store(metric.sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	metric.last.store(value, std::memory_order_relaxed);
+	metric.stamp.store(stamp, std::memory_order_relaxed);
+	metric.count.store(count + 1, std::memory_order_relaxed);
+}
+
+std::vector<TimingStatistics::MetricTotals>
+TimingStatistics::collectMetrics() {
+
+	TimerId numTimerIds;
+	{
+		std::lock_guard<std::mutex> lock(_timerIdsMutex);
+		numTimerIds = _numTimerIds;
+	}
+
+	// only the ids assigned so far can have metrics
+	std::vector<MetricTotals> totals(_endedThreadMetrics);
+	totals.resize(std::max<size_t>(totals.size(), numTimerIds));
+
+	for (ThreadTimes* threadTimes : _threads) {
+
+		for (TimerId id = 0; id < totals.size(); id++) {
+
+			ThreadMetric* page = threadTimes->metrics.pages[id >> MetricPageBits].load(std::memory_order_acquire);
+			if (!page) {
+
+				id |= MetricPageSize - 1;
+				continue;
+			}
+
+			totals[id].add(page[id & (MetricPageSize - 1)]);
+		}
+	}
+
+	return totals;
+}
+
+TimingStatistics::Metrics
+TimingStatistics::metricsSince(std::vector<MetricTotals>& baseline, std::chrono::steady_clock::time_point& begin, bool reset) {
+
+	std::vector<MetricTotals> totals = collectMetrics();
+	baseline.resize(totals.size());
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	Metrics metrics;
+
+	for (TimerId id = 0; id < totals.size(); id++) {
+
+		unsigned char kind = _metricKinds[id].load(std::memory_order_relaxed);
+
+		if (kind == 0 || totals[id].count == baseline[id].count)
+			continue;
+
+		MetricStatistics& metric = metrics[getIdentifier(id)];
+		metric.kind    = static_cast<MetricKind>(kind);
+		metric.count   = totals[id].count - baseline[id].count;
+		metric.seconds = std::chrono::duration<double>(now - begin).count();
+		metric.sum     = totals[id].sum - baseline[id].sum;
+		metric.min     = totals[id].min;
+		metric.max     = totals[id].max;
+		metric.last    = totals[id].last;
+	}
+
+	if (reset) {
+
+		baseline.swap(totals);
+		begin = now;
+	}
+
+	return metrics;
+}
+
+const char*
+TimingStatistics::findIdentifier(TimerId id) {
+
+	if (id > MaxTimerIds)
+		return 0;
+
+	const std::string* identifier = _instance._identifiers[id].load(std::memory_order_acquire);
+
+	return (identifier ? identifier->c_str() : 0);
+}
+
+TimingStatistics::Metrics
+TimingStatistics::snapshotMetrics(bool reset) {
+
+	std::lock_guard<std::mutex> lock(_instance._mutex);
+
+	return _instance.metricsSince(_instance._metricsBaseline, _instance._metricsBegin, reset);
+}
+
+TimingStatistics::ThreadTimes&
+TimingStatistics::getThreadTimes() {
+
+	thread_local ThreadTimes threadTimes;
+
+	return threadTimes;
+}
+
+TimerId
+TimingStatistics::getId(const std::string& identifier, unsigned char kind) {
+
+	// the cache of this thread is gone if called from the destructor of
+	// another thread local object
+	ThreadTimes* threadTimes = (threadTimesReleased ? 0 : &getThreadTimes());
+
+	if (threadTimes) {
+
+		std::unordered_map<std::string, TimerId>::const_iterator cached = threadTimes->timerIds.find(identifier);
+		if (cached != threadTimes->timerIds.end()) {
+
+			checkKind(identifier, cached->second, kind);
+			return cached->second;
+		}
+	}
+
+	TimerId id;
+
+	{
+		std::lock_guard<std::mutex> lock(_instance._timerIdsMutex);
+
+		std::map<std::string, TimerId>::iterator i = _instance._timerIds.find(identifier);
+
+		if (i == _instance._timerIds.end()) {
+
+			if (_instance._numTimerIds == MaxTimerIds)
+				UTIL_THROW_EXCEPTION(
+						UsageError,
+						"too many different timer identifiers (" << MaxTimerIds << "), can not add " << identifier);
+
+			i = _instance._timerIds.insert(std::make_pair(identifier, _instance._numTimerIds)).first;
+
+			// the key of the map entry is the stable copy of the identifier
+			_instance._identifiers[_instance._numTimerIds].store(&i->first, std::memory_order_release);
+			_instance._timerEnabled[_instance._numTimerIds].store(_instance.isEnabled(identifier), std::memory_order_relaxed);
+			_instance._metricKinds[_instance._numTimerIds].store(kind, std::memory_order_relaxed);
+			_instance._numTimerIds++;
+		}
+
+		id = i->second;
+	}
+
+	checkKind(identifier, id, kind);
+
+	if (threadTimes)
+		threadTimes->timerIds[identifier] = id;
+
+	return id;
+}
+
+void
+TimingStatistics::kindMismatch(const std::string& name, unsigned char registered, unsigned char kind) {
+
+	UTIL_THROW_EXCEPTION(
+			UsageError,
+			"can not use " << name << " as a " << kindName(kind) << ", it is already used as a " << kindName(registered));
+}
+
+void
+TimingStatistics::setEnabled(bool enabled) {
+
+	std::lock_guard<std::mutex> lock(_instance._timerIdsMutex);
+
+	_enabled.store(enabled, std::memory_order_relaxed);
+	_instance.updateEnabled();
+}
+
+void
+TimingStatistics::setPrefixes(const std::vector<std::string>& prefixes) {
+
+	std::lock_guard<std::mutex> lock(_instance._timerIdsMutex);
+
+	_instance._prefixes = prefixes;
+	_instance.updateEnabled();
+}
+
+bool
+TimingStatistics::isEnabled(const std::string& identifier) {
+
+	if (!_enabled.load(std::memory_order_relaxed))
+		return false;
+
+	if (_prefixes.empty())
+		return true;
+
+	for (const std::string& prefix : _prefixes)
+		if (identifier.compare(0, prefix.size(), prefix) == 0)
+			return true;
+
+	return false;
+}
+
+void
+TimingStatistics::updateEnabled() {
+
+	for (const auto& p : _timerIds)
+		_timerEnabled[p.second].store(isEnabled(p.first), std::memory_order_relaxed);
+
+	_timerEnabled[NoTimer].store(false, std::memory_order_relaxed);
+}
+
+bool
+TimingStatistics::setCountersEnabled(bool enabled) {
+
+	if (enabled && !PerfCounters::threadCounters().isAvailable())
+		return false;
+
+	_countersEnabled = enabled;
+
+	return true;
+}
+
+bool
+TimingStatistics::setAllocationsEnabled(bool enabled) {
+
+	if (enabled && !AllocationTracker::isAvailable())
+		return false;
+
+	AllocationTracker::setEnabled(enabled);
+	_allocationsEnabled = enabled;
+
+	return true;
+}
+
+bool
+TimingStatistics::sample(TimerId id) {
+
+	ThreadTimes& threadTimes = getThreadTimes();
+
+	if (id >= threadTimes.skipped.size())
+		threadTimes.skipped.resize(id + 1, 0);
+
+	// take the first run, then skip _sampling - 1 runs
+	unsigned int& skipped = threadTimes.skipped[id];
+	bool take = (skipped == 0);
+
+	if (++skipped >= _sampling)
+		skipped = 0;
+
+	return take;
+}
+
+TimingStatistics::Statistics&
+TimingStatistics::getStatistics(ThreadTimes& threadTimes, TimerId id) {
+
+	if (id >= threadTimes.times.size())
+		threadTimes.times.resize(id + 1);
+
+	std::unique_ptr<Statistics>& statistics = threadTimes.times[id];
+
+	if (!statistics)
+		statistics.reset(new Statistics());
+
+	return *statistics;
+}
+
+void
+TimingStatistics::addTimer(const std::string& identifier, float elapsed, float cpu) {
+
+	TimerId id = getTimerId(identifier);
+
+	ThreadTimes& threadTimes = getThreadTimes();
+
+	std::lock_guard<std::mutex> lock(threadTimes.mutex);
+
+	Statistics& statistics = getStatistics(threadTimes, id);
+	statistics.wall.add(elapsed);
+	statistics.cpu += cpu;
+}
+
+void
+TimingStatistics::enterScope(TimerId id) {
+
+	ThreadTimes& threadTimes = getThreadTimes();
+
+	std::lock_guard<std::mutex> lock(threadTimes.mutex);
+
+	CallTreeNode* parent = (threadTimes.scopes.empty() ? &threadTimes.callTree : threadTimes.scopes.back());
+	threadTimes.scopes.push_back(&parent->children[id]);
+}
+
+void
+TimingStatistics::leaveScope(const Timer& timer) {
+
+	ThreadTimes& threadTimes = getThreadTimes();
+
+	float elapsed = timer.elapsed();
+
+	std::lock_guard<std::mutex> lock(threadTimes.mutex);
+
+	Statistics& statistics = getStatistics(threadTimes, timer.getId());
+	statistics.wall.add(elapsed);
+	statistics.cpu += timer.cpuElapsed();
+
+	uint64_t deltas[PerfCounters::NumCounters];
+	if (timer.counterDeltas(deltas)) {
+
+		statistics.countedRuns++;
+		for (int i = 0; i < PerfCounters::NumCounters; i++)
+			statistics.counters[i] += deltas[i];
+	}
+
+	uint64_t allocations, bytes;
+	int64_t  peak;
+	if (timer.allocationCounts(allocations, bytes, peak)) {
+
+		statistics.trackedRuns++;
+		statistics.allocations    += allocations;
+		statistics.allocatedBytes += bytes;
+		statistics.peakBytes       = std::max(statistics.peakBytes, peak);
+	}
+
+	if (_traceEnabled) {
+
+		ThreadTimes::Event event;
+		event.identifier = timer.getId();
+		event.begin      = timer.startTime();
+		event.duration   = elapsed*1e9;
+		threadTimes.events.push_back(event);
+	}
+
+	if (threadTimes.scopes.empty())
+		return;
+
+	CallTreeNode* node = threadTimes.scopes.back();
+	node->count++;
+	node->inclusive += elapsed;
+	threadTimes.scopes.pop_back();
+}
+
+void
+TimingStatistics::flush() {
+
+	std::lock_guard<std::mutex> lock(_instance._mutex);
+
+	for (ThreadTimes* threadTimes : _instance._threads)
+		_instance.merge(*threadTimes);
+}
+
+TimingStatistics::Times
+TimingStatistics::snapshot(bool reset) {
+
+	flush();
+
+	std::lock_guard<std::mutex> lock(_instance._mutex);
+
+	Times times;
+
+	for (Times::value_type& p : _instance._times) {
+
+		if (p.second.wall.count() == 0)
+			continue;
+
+		times[p.first] = p.second;
+
+		if (reset)
+			p.second.clear();
+	}
+
+	if (reset)
+		_instance._callTree.clear();
+
+	return times;
+}
+
+void
+TimingStatistics::reset() {
+
+	snapshot(true);
+	snapshotMetrics(true);
+}
+
+void
+TimingStatistics::startReporter(double interval, const std::string& filename) {
+
+	stopReporter();
+
+	flush();
+
+	{
+		std::lock_guard<std::mutex> lock(_instance._mutex);
+
+		_instance._interval.clear();
+		_instance._collectInterval = true;
+
+		// start the first interval of the metrics now
+		_instance.metricsSince(_instance._intervalMetricsBaseline, _instance._intervalMetricsBegin, true);
+	}
+
+	_instance._stopReporter   = false;
+	_instance._reportInterval = interval;
+	_instance._reportFile     = filename;
+	_instance._reporter       = std::thread(&TimingStatistics::reportLoop, &_instance);
+}
+
+void
+TimingStatistics::stopReporter() {
+
+	if (!_instance._reporter.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_instance._reporterMutex);
+		_instance._stopReporter = true;
+	}
+
+	_instance._reporterWakeup.notify_all();
+	_instance._reporter.join();
+
+	std::lock_guard<std::mutex> lock(_instance._mutex);
 
-	boost::chrono::nanoseconds ns(_timer.elapsed().system + _timer.elapsed().user);
-	boost::chrono::duration<float> s = ns;
+	_instance._collectInterval = false;
+	_instance._interval.clear();
+}
+
+void
+TimingStatistics::reportLoop() {
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point next  = begin;
+
+	std::unique_lock<std::mutex> lock(_reporterMutex);
+
+	bool stopped = false;
+	while (!stopped) {
+
+		next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::duration<double>(_reportInterval));
+
+		stopped = _reporterWakeup.wait_until(lock, next, [this]{ return _stopReporter; });
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+		try {
+
+			report(seconds);
+
+		} catch (boost::exception& e) {
+
+			handleException(e, std::cerr);
+		}
+	}
+}
+
+void
+TimingStatistics::report(double seconds) {
+
+	flush();
+
+	Times   interval;
+	Metrics metrics;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		interval.swap(_interval);
+		metrics = metricsSince(_intervalMetricsBaseline, _intervalMetricsBegin, true);
+	}
+
+	if (interval.empty() && metrics.empty())
+		return;
+
+	std::stringstream report;
+	report << "timing report after " << std::fixed << std::setprecision(1) << seconds << "s" << std::endl;
+	if (!interval.empty())
+		printSummary(report, interval);
+	if (!metrics.empty())
+		printMetrics(report, metrics);
+
+	if (_reportFile.empty()) {
+
+		LOG_USER(timinglog) << report.str() << std::endl;
+		return;
+	}
+
+	std::ofstream out(_reportFile.c_str(), std::ios::app);
+	out << report.str() << std::endl;
+
+	if (!out)
+		UTIL_THROW_EXCEPTION(IOError, "writing to " << _reportFile << " failed");
+}
+
+void
+TimingStatistics::merge(ThreadTimes& threadTimes) {
+
+	std::lock_guard<std::mutex> lock(threadTimes.mutex);
+
+	for (TimerId id = 0; id < threadTimes.times.size(); id++) {
+
+		Statistics* statistics = threadTimes.times[id].get();
+
+		if (!statistics || statistics->wall.count() == 0)
+			continue;
+
+		_times[getIdentifier(id)].merge(*statistics);
+		if (_collectInterval)
+			_interval[getIdentifier(id)].merge(*statistics);
+		statistics->clear();
+	}
+
+	_callTree.merge(threadTimes.callTree);
+	threadTimes.callTree.clear();
 
-	return s.count();
+	for (const ThreadTimes::Event& event : threadTimes.events) {
+
+		TraceEvent traceEvent;
+		traceEvent.identifier = event.identifier;
+		traceEvent.thread     = threadTimes.id;
+		traceEvent.begin      = event.begin;
+		traceEvent.duration   = event.duration;
+		_traceEvents.push_back(traceEvent);
+	}
+
+	threadTimes.events.clear();
 }
-TimingStatistics::TimingStatistics() {}
 
 void
-TimingStatistics::addTimer(const std::string& identifier, float elapsed) {
+TimingStatistics::writeTrace(const std::string& filename) {
+
+	flush();
+
+	std::lock_guard<std::mutex> lock(_instance._mutex);
+
+	std::ofstream out(filename.c_str());
+
+	if (!out)
+		UTIL_THROW_EXCEPTION(IOError, "can not open " << filename << " for writing");
+
+	// escaped identifiers
+	std::map<TimerId, std::string> names;
+	for (const TraceEvent& event : _instance._traceEvents) {
 
-	_instance._times[identifier].push_back(elapsed);
+		if (names.count(event.identifier))
+			continue;
+
+		names[event.identifier] = jsonEscape(getIdentifier(event.identifier));
+	}
+
+	uint64_t origin = (_instance._traceEvents.empty() ? 0 : _instance._traceEvents.front().begin);
+	for (const TraceEvent& event : _instance._traceEvents)
+		origin = std::min(origin, event.begin);
+
+	int pid = getpid();
+
+	out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" << std::endl;
+	out << std::fixed << std::setprecision(3);
+
+	bool first = true;
+	for (const TraceEvent& event : _instance._traceEvents) {
+
+		if (!first)
+			out << "," << std::endl;
+		first = false;
+
+		out
+				<< "{\"name\":\"" << names[event.identifier] << "\",\"ph\":\"X\""
+				<< ",\"pid\":" << pid
+				<< ",\"tid\":" << event.thread
+				<< ",\"ts\":" << (event.begin - origin)*1e-3
+				<< ",\"dur\":" << event.duration*1e-3 << "}";
+	}
+
+	out << std::endl << "]}" << std::endl;
+
+	if (!out)
+		UTIL_THROW_EXCEPTION(IOError, "writing to " << filename << " failed");
 }
 
 TimingStatistics::~TimingStatistics() {
 
-	if (_times.size() == 0)
+	stopReporter();
+
+	flush();
+
+	if (!_traceFile.empty()) {
+
+		try {
+
+			writeTrace(_traceFile);
+
+		} catch (boost::exception& e) {
+
+			handleException(e, std::cerr);
+		}
+	}
+
+	Metrics metrics = snapshotMetrics();
+
+	if (_times.size() == 0 && metrics.empty())
 		return;
 
+	std::ofstream file;
+	if (!_outputFile.empty())
+		file.open(_outputFile.c_str());
+
+	std::ostream& out = (_outputFile.empty() ? std::cout : file);
+
+	writeSummary(out, _times, _format, metrics);
+
+	if (_showCallTree)
+		printCallTree(out);
+
+	if (!_outputFile.empty() && !file)
+		std::cerr << "writing the timing summary to " << _outputFile << " failed" << std::endl;
+}
+
+void
+TimingStatistics::writeSummary(std::ostream& out, const Times& times, Format format, const Metrics& metrics) {
+
+	switch (format) {
+
+		case Csv:
+			writeCsv(out, times, metrics);
+			break;
+
+		case Json:
+			writeJson(out, times, metrics);
+			break;
+
+		default:
+			if (!times.empty())
+				printSummary(out, times);
+			if (!metrics.empty())
+				printMetrics(out, metrics);
+	}
+}
+
+void
+TimingStatistics::printMetrics(std::ostream& out, const Metrics& metrics) {
+
 	const std::string spacer("   ");
 
-	std::cout
-			<< "timing summary in seconds (cpu time):"
+	int longestIdentifierLength = 0;
+	for (const Metrics::value_type& p : metrics)
+		longestIdentifierLength = std::max(longestIdentifierLength, (int)p.first.size());
+
+	out
+			<< std::endl
+			<< "counters (total and rate per second) and gauges (last, min, max, and mean value):"
 			<< std::endl << std::endl;
 
-	int longestIdentifierLength = 0;
-	for (const Times::value_type& p : _times) {
+	for (const Metrics::value_type& p : metrics) {
+
+		const MetricStatistics& metric = p.second;
+
+		out << p.first;
+		for (int i = 0; i < longestIdentifierLength - (int)p.first.size(); i++)
+			out << " ";
+		out << spacer;
+		out << std::scientific << std::setprecision(3);
+
+		if (metric.kind == Counter)
+			out
+					<< "total " << std::setw(9) << (double)metric.count << spacer
+					<< "rate " << std::setw(9) << metric.rate();
+		else
+			out
+					<< "last " << std::setw(10) << metric.last << spacer
+					<< "min " << std::setw(10) << metric.min << spacer
+					<< "max " << std::setw(10) << metric.max << spacer
+					<< "mean " << std::setw(10) << metric.mean();
+
+		out << std::endl;
+	}
+}
+
+void
+TimingStatistics::writeCsv(std::ostream& out, const Times& times, const Metrics& metrics) {
+
+	out << "identifier,runs,mean,min,max,median,p90,p99,p99.9,total,cpu_total,ipc,cache_misses_per_run,branch_misses_per_run,allocations_per_run,bytes_per_run,peak_bytes" << std::endl;
+	out << std::setprecision(9);
+
+	for (const Times::value_type& p : times) {
+
+		const Statistics&    s       = p.second;
+		const TimingSummary& summary = s.wall;
+
+		if (summary.count() == 0)
+			continue;
+
+		out
+				<< csvQuote(p.first) << ","
+				<< summary.count() << ","
+				<< summary.mean() << ","
+				<< summary.min() << ","
+				<< summary.max() << ","
+				<< summary.quantile(0.5) << ","
+				<< summary.quantile(0.9) << ","
+				<< summary.quantile(0.99) << ","
+				<< summary.quantile(0.999) << ","
+				<< summary.sum() << ","
+				<< s.cpu << ",";
+
+		// leave the counter columns empty, if there are no counter values
+		if (s.countedRuns > 0) {
+
+			double runs = s.countedRuns;
+
+			out
+					<< (s.counters[PerfCounters::Cycles] ? (double)s.counters[PerfCounters::Instructions]/s.counters[PerfCounters::Cycles] : 0.0) << ","
+					<< s.counters[PerfCounters::CacheMisses]/runs << ","
+					<< s.counters[PerfCounters::BranchMisses]/runs;
+
+		} else {
+
+			out << ",,";
+		}
+
+		out << ",";
+
+		if (s.trackedRuns > 0) {
+
+			double runs = s.trackedRuns;
+
+			out
+					<< s.allocations/runs << ","
+					<< s.allocatedBytes/runs << ","
+					<< s.peakBytes;
+
+		} else {
+
+			out << ",,";
+		}
+
+		out << std::endl;
+	}
+
+	if (metrics.empty())
+		return;
+
+	out << std::endl << "metric,kind,count,rate,mean,min,max,last" << std::endl;
+
+	for (const Metrics::value_type& p : metrics) {
+
+		const MetricStatistics& m = p.second;
+
+		out << csvQuote(p.first) << "," << (m.kind == Counter ? "counter" : "gauge") << "," << m.count << ",";
+
+		if (m.kind == Counter)
+			out << m.rate() << ",,,,";
+		else
+			out << "," << m.mean() << "," << m.min << "," << m.max << "," << m.last;
+
+		out << std::endl;
+	}
+}
+
+void
+TimingStatistics::writeJson(std::ostream& out, const Times& times, const Metrics& metrics) {
+
+	out << "{\"unit\":\"s\",\"timers\":[" << std::endl;
+	out << std::setprecision(9);
+
+	bool first = true;
+	for (const Times::value_type& p : times) {
+
+		const Statistics&    s       = p.second;
+		const TimingSummary& summary = s.wall;
+
+		if (summary.count() == 0)
+			continue;
+
+		if (!first)
+			out << "," << std::endl;
+		first = false;
+
+		out
+				<< "{\"identifier\":\"" << jsonEscape(p.first) << "\""
+				<< ",\"runs\":" << summary.count()
+				<< ",\"mean\":" << summary.mean()
+				<< ",\"min\":" << summary.min()
+				<< ",\"max\":" << summary.max()
+				<< ",\"median\":" << summary.quantile(0.5)
+				<< ",\"p90\":" << summary.quantile(0.9)
+				<< ",\"p99\":" << summary.quantile(0.99)
+				<< ",\"p99.9\":" << summary.quantile(0.999)
+				<< ",\"total\":" << summary.sum()
+				<< ",\"cpu_total\":" << s.cpu;
+
+		if (s.countedRuns > 0) {
+
+			double runs = s.countedRuns;
+
+			out
+					<< ",\"ipc\":" << (s.counters[PerfCounters::Cycles] ? (double)s.counters[PerfCounters::Instructions]/s.counters[PerfCounters::Cycles] : 0.0)
+					<< ",\"cache_misses_per_run\":" << s.counters[PerfCounters::CacheMisses]/runs
+					<< ",\"branch_misses_per_run\":" << s.counters[PerfCounters::BranchMisses]/runs;
+		}
+
+		if (s.trackedRuns > 0) {
+
+			double runs = s.trackedRuns;
+
+			out
+					<< ",\"allocations_per_run\":" << s.allocations/runs
+					<< ",\"bytes_per_run\":" << s.allocatedBytes/runs
+					<< ",\"peak_bytes\":" << s.peakBytes;
+		}
+
+		out << "}";
+	}
+
+	out << std::endl << "],\"metrics\":[" << std::endl;
+
+	first = true;
+	for (const Metrics::value_type& p : metrics) {
+
+		const MetricStatistics& m = p.second;
+
+		if (!first)
+			out << "," << std::endl;
+		first = false;
+
+		out
+				<< "{\"metric\":\"" << jsonEscape(p.first) << "\""
+				<< ",\"kind\":\"" << (m.kind == Counter ? "counter" : "gauge") << "\""
+				<< ",\"count\":" << m.count;
+
+		if (m.kind == Counter)
+			out << ",\"rate\":" << m.rate();
+		else
+			out
+					<< ",\"mean\":" << m.mean()
+					<< ",\"min\":" << m.min
+					<< ",\"max\":" << m.max
+					<< ",\"last\":" << m.last;
+
+		out << "}";
+	}
+
+	out << std::endl << "]}" << std::endl;
+}
+
+void
+TimingStatistics::printSummary(std::ostream& out, const Times& times) {
+
+	const std::string spacer("   ");
+
+	bool showCpu = (Timer::getClock() == Timer::Cpu);
+
+	out
+			<< "timing summary in seconds (wall time"
+			<< (showCpu ? ", cpu time of the timed threads in the last columns" : "")
+			<< "):"
+			<< std::endl;
+	if (_sampling > 1)
+		out << "(sampled: 1 in " << _sampling << " runs of each scope)" << std::endl;
+	out << std::endl;
+
+	int  longestIdentifierLength = 0;
+	bool showCounters    = false;
+	bool showAllocations = false;
+	for (const Times::value_type& p : times) {
 
 		const std::string&  identifier = p.first;
 		longestIdentifierLength = std::max(longestIdentifierLength, (int)identifier.size());
+		showCounters    |= (p.second.countedRuns > 0);
+		showAllocations |= (p.second.trackedRuns > 0);
 	}
 
 	for (int i = 0; i < longestIdentifierLength; i++)
-		std::cout << " ";
-	std::cout << spacer;
-	std::cout << "   # runs" << spacer;
-	std::cout << "mean     " << spacer;
-	std::cout << "min      " << spacer;
-	std::cout << "max      " << spacer;
-	std::cout << "median   " << spacer;
-	std::cout << "total" << std::endl << std::endl;
+		out << " ";
+	out << spacer;
+	out << "   # runs" << spacer;
+	out << "mean     " << spacer;
+	out << "min      " << spacer;
+	out << "max      " << spacer;
+	out << "median   " << spacer;
+	out << "p90      " << spacer;
+	out << "p99      " << spacer;
+	out << "p99.9    " << spacer;
+	out << "total";
+	if (showCpu) {
+		out << "    " << spacer;
+		out << "cpu mean " << spacer;
+		out << "cpu total";
+	}
+	if (showCounters) {
+		out << spacer;
+		out << "      IPC" << spacer;
+		out << "cache miss/run" << spacer;
+		out << "branch miss/run";
+	}
+	if (showAllocations) {
+		out << spacer;
+		out << "allocs/run" << spacer;
+		out << "bytes/run" << spacer;
+		out << "peak bytes";
+	}
+	out << std::endl << std::endl;
 
-	for (Times::value_type& p : _times) {
+	for (const Times::value_type& p : times) {
 
-		const std::string&  identifier = p.first;
-		std::vector<float>& times      = p.second;
-
-		int numRuns = times.size();
-		float total = 0;
-
-		for (float t : times)
-			total += t;
-
-		float mean = total/numRuns;
-
-		std::nth_element(times.begin(), times.begin(), times.end());
-		float min    = times[0];
-		std::nth_element(times.begin(), times.begin() + numRuns - 1, times.end());
-		float max    = times[numRuns - 1];
-		std::nth_element(times.begin(), times.begin() + numRuns/2, times.end());
-		float median = times[numRuns/2];
-
-		std::cout << identifier;
-		for (int i = 0; i < longestIdentifierLength - identifier.size(); i++)
-			std::cout << " ";
-		std::cout << spacer;
-		std::cout << std::setw(9) << std::setfill(' ');
-		std::cout << numRuns << spacer;
-		std::cout << std::scientific << std::setprecision(3);
-		std::cout << mean << spacer;
-		std::cout << min << spacer;
-		std::cout << max << spacer;
-		std::cout << median << spacer;
-		std::cout << total;
-		std::cout << std::endl;
+		const std::string&   identifier = p.first;
+		const TimingSummary& summary    = p.second.wall;
+
+		if (summary.count() == 0)
+			continue;
+
+		out << identifier;
+		for (int i = 0; i < longestIdentifierLength - (int)identifier.size(); i++)
+			out << " ";
+		out << spacer;
+		out << std::setw(9) << std::setfill(' ');
+		out << summary.count() << spacer;
+		out << std::scientific << std::setprecision(3);
+		out << summary.mean() << spacer;
+		out << summary.min() << spacer;
+		out << summary.max() << spacer;
+		out << summary.quantile(0.5) << spacer;
+		out << summary.quantile(0.9) << spacer;
+		out << summary.quantile(0.99) << spacer;
+		out << summary.quantile(0.999) << spacer;
+		out << summary.sum();
+		if (showCpu) {
+			out << spacer;
+			out << p.second.cpu/summary.count() << spacer;
+			out << p.second.cpu;
+		}
+		if (showCounters && p.second.countedRuns > 0) {
+
+			const Statistics& s = p.second;
+			double runs = s.countedRuns;
+
+			out << spacer;
+			out << std::fixed << std::setprecision(2) << std::setw(9);
+			out << (s.counters[PerfCounters::Cycles] ? (double)s.counters[PerfCounters::Instructions]/s.counters[PerfCounters::Cycles] : 0.0) << spacer;
+			out << std::scientific << std::setprecision(3);
+			out << std::setw(14) << s.counters[PerfCounters::CacheMisses]/runs << spacer;
+			out << std::setw(15) << s.counters[PerfCounters::BranchMisses]/runs;
+		}
+		if (showAllocations && p.second.trackedRuns > 0) {
+
+			const Statistics& s = p.second;
+			double runs = s.trackedRuns;
+
+			// keep the columns aligned, if there are no counter values here
+			if (showCounters && s.countedRuns == 0)
+				out << spacer << std::setw(9 + 14 + 15 + 2*spacer.size()) << "";
+
+			out << spacer;
+			out << std::scientific << std::setprecision(3);
+			out << std::setw(10) << s.allocations/runs << spacer;
+			out << std::setw(9) << s.allocatedBytes/runs << spacer;
+			out << std::setw(10) << s.peakBytes;
+		}
+		out << std::endl;
+	}
+}
+
+void
+TimingStatistics::printCallTree(std::ostream& out) {
+
+	const std::string spacer("   ");
+
+	// the widest indented identifier
+	int width = 0;
+	std::vector<std::pair<const CallTreeNode*, int>> nodes(1, std::make_pair(&_callTree, -1));
+	while (!nodes.empty()) {
+
+		const CallTreeNode* node  = nodes.back().first;
+		int                 depth = nodes.back().second;
+		nodes.pop_back();
+
+		for (const auto& p : node->children) {
+
+			width = std::max(width, 2*(depth + 1) + (int)getIdentifier(p.first).size());
+			nodes.push_back(std::make_pair(&p.second, depth + 1));
+		}
+	}
+
+	out
+			<< std::endl
+			<< "timing call tree in seconds (wall time):"
+			<< std::endl << std::endl;
+
+	for (int i = 0; i < width; i++)
+		out << " ";
+	out << spacer;
+	out << "   # runs" << spacer;
+	out << "inclusive" << spacer;
+	out << "exclusive" << spacer;
+	out << "% parent";
+	out << std::endl << std::endl;
+
+	for (const auto& p : _callTree.children)
+		printCallTreeNode(out, p.first, p.second, 0, width, 0);
+}
+
+void
+TimingStatistics::printCallTreeNode(std::ostream& out, TimerId id, const CallTreeNode& node, int depth, int width, double parentTime) {
+
+	if (node.totalCount() == 0)
+		return;
+
+	const std::string& identifier = getIdentifier(id);
+
+	const std::string spacer("   ");
+
+	for (int i = 0; i < 2*depth; i++)
+		out << " ";
+	out << identifier;
+	for (int i = 0; i < width - 2*depth - (int)identifier.size(); i++)
+		out << " ";
+	out << spacer;
+	out << std::setw(9) << std::setfill(' ');
+	out << node.count << spacer;
+	out << std::scientific << std::setprecision(3);
+	out << node.inclusive << spacer;
+	out << std::max(0.0, node.inclusive - node.childTime());
+	if (parentTime > 0) {
+		out << spacer;
+		out << std::fixed << std::setprecision(1) << std::setw(8);
+		out << 100.0*node.inclusive/parentTime;
 	}
+	out << std::endl;
+
+	for (const auto& p : node.children)
+		printCallTreeNode(out, p.first, p.second, depth + 1, width, node.inclusive);
 }
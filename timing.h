@@ -1,63 +1,920 @@
 #ifndef UTIL_TIMING_H__
 #define UTIL_TIMING_H__
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
 #include <vector>
-#include <boost/timer/timer.hpp>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 #include "typename.h"
+#include "allocation_tracker.h"
+#include "flight_recorder.h"
+#include "perf_counters.h"
+#include "timing_summary.h"
 
-#define UTIL_TIME_SCOPE(name) Timer __util_scope_timer(name);
-#define UTIL_TIME_METHOD      Timer __util_method_timer(typeName(*this) + "::" + __FUNCTION__ + "()");
+// the name is not evaluated if timing is disabled
+#define UTIL_TIME_SCOPE(name) \
+	Timer __util_scope_timer( \
+			TimingStatistics::isEnabled() ? \
+			TimingStatistics::getTimerId(name) : \
+			TimingStatistics::NoTimer);
+
+// the identifier is created and registered only once per method, from the
+// static type of *this, and like for UTIL_TIME_SCOPE not at all if timing is
+// disabled
+#define UTIL_TIME_METHOD \
+	Timer __util_method_timer( \
+			TimingStatistics::isEnabled() ? \
+			[this](const char* function) { \
+				static const TimerId util_method_timer_id_ = \
+						TimingStatistics::getTimerId( \
+								demangle(typeid(typename std::remove_reference<decltype(*this)>::type).name()) + \
+								"::" + function + "()"); \
+				return util_method_timer_id_; \
+			}(__FUNCTION__) : \
+			TimingStatistics::NoTimer);
+
+// add n to the counter name, the name is only evaluated once per callsite
+#define UTIL_COUNT(name, n) \
+	do { \
+		static const TimerId util_counter_id_ = TimingStatistics::getMetricId(name, TimingStatistics::Counter); \
+		TimingStatistics::count(util_counter_id_, n); \
+	} while (false)
+
+// set the gauge name to v, the name is only evaluated once per callsite
+#define UTIL_GAUGE(name, v) \
+	do { \
+		static const TimerId util_gauge_id_ = TimingStatistics::getMetricId(name, TimingStatistics::Gauge); \
+		TimingStatistics::gauge(util_gauge_id_, v); \
+	} while (false)
 
 class Timer;
 
+/**
+ * A small integer representing a timer identifier, see
+ * TimingStatistics::getTimerId().
+ */
+typedef unsigned int TimerId;
+
+/**
+ * Collects the elapsed times of all Timers and prints a summary at the end of
+ * the program. Times are aggregated per identifier in a TimingSummary, such
+ * that memory does not grow with the number of recorded times.
+ *
+ * Nested timers are additionally aggregated into a call tree with inclusive
+ * and exclusive times per node, which can be printed with the
+ * --timing-call-tree option.
+ *
+ * Each thread records its times in a thread-local buffer, such that recording
+ * does not contend with other threads. The buffers are merged into the global
+ * statistics when a thread ends, on flush(), and before the summary is
+ * printed.
+ *
+ * Timing can be switched off at runtime (--timing=false), restricted to
+ * identifiers with certain prefixes (--timing-prefixes), and reduced to every
+ * n-th run of each scope in each thread (--timing-sample). A disabled Timer
+ * does not read any clock and costs a single branch. Scopes that are not
+ * timed do not appear in the call tree, such that their timed children are
+ * attributed to the next enclosing timed scope. With sampling, where each
+ * scope is sampled independently, the call tree is therefore approximate.
+ *
+ * For long running programs, snapshot() returns the statistics collected so
+ * far, and a background thread started with startReporter() (or the option
+ * --timing-report-interval) periodically writes a summary of the last
+ * interval to a file or the log channel timinglog.
+ *
+ * The summary is written as a table to std::cout by default. Use
+ * --timing-format and --timing-output to write CSV or JSON, e.g., to compare
+ * runs with the timing_diff tool.
+ *
+ * With --timing-counters, Timers additionally read the hardware performance
+ * counters of their thread (see PerfCounters), and the summary shows the
+ * instructions per cycle and the cache and branch misses per run.
+ *
+ * With --timing-allocations (and util built with
+ * BUILD_UTIL_ALLOCATION_TRACKER), Timers count the heap allocations of their
+ * thread (see AllocationTracker). Allocations and allocated bytes are
+ * attributed to the innermost running Timer only, the peak of live bytes
+ * includes nested Timers.
+ *
+ * Besides Timers, UTIL_COUNT(name, n) adds to a counter (e.g., items
+ * processed or bytes written) and UTIL_GAUGE(name, v) records the current
+ * value of a gauge (e.g., a queue depth). Each thread updates its own slots of
+ * these metrics without locks, the slots of all threads are summed up for
+ * snapshotMetrics() and the report. Counters are reported with their total and
+ * rate per second, gauges with their last, minimal, maximal, and mean value.
+ * Timers, counters, and gauges need distinct names.
+ */
 class TimingStatistics {
 
 public:
 
-	typedef std::map<std::string, std::vector<float>> Times;
+	/**
+	 * The statistics of one identifier: a summary of the wall times, the
+	 * total CPU time, and the total hardware counter values.
+	 */
+	struct Statistics {
+
+		Statistics() { clear(); }
+
+		void merge(const Statistics& other);
+
+		void clear();
+
+		TimingSummary wall;
+
+		double cpu;
+
+		// the number of runs with hardware counter values
+		uint64_t countedRuns;
+
+		uint64_t counters[PerfCounters::NumCounters];
+
+		// the number of runs with allocation counts
+		uint64_t trackedRuns;
+
+		uint64_t allocations;
+
+		uint64_t allocatedBytes;
+
+		// the highest peak of live bytes of all runs
+		int64_t peakBytes;
+	};
+
+	typedef std::map<std::string, Statistics> Times;
+
+	/**
+	 * A node in the call tree of nested timers. The children of a node are the
+	 * timers that were started while the node's timer was running.
+	 */
+	struct CallTreeNode {
+
+		CallTreeNode() : count(0), inclusive(0) {}
+
+		// add the counts and times of other and its descendants to this node
+		void merge(const CallTreeNode& other);
+
+		// reset the counts and times, but keep the nodes
+		void clear();
+
+		// the total inclusive time of all children
+		double childTime() const;
+
+		// the number of runs in this node and all its descendants
+		uint64_t totalCount() const;
+
+		uint64_t count;
+
+		// time spent in this node, including its children
+		double inclusive;
+
+		std::map<TimerId, CallTreeNode> children;
+	};
+
+	/**
+	 * The kinds of metrics, see UTIL_COUNT and UTIL_GAUGE.
+	 */
+	enum MetricKind {
+
+		Counter = 1,
+		Gauge   = 2
+	};
+
+	/**
+	 * The statistics of one counter or gauge.
+	 */
+	struct MetricStatistics {
+
+		MetricKind kind;
+
+		// the sum of all increments of a counter, or the number of updates of
+		// a gauge
+		uint64_t count;
+
+		// the time over which the metric was collected
+		double seconds;
+
+		// the sum, minimum, maximum, and last of all values of a gauge
+		double sum;
+		double min;
+		double max;
+		double last;
+
+		double rate() const { return seconds > 0 ? count/seconds : 0; }
+
+		double mean() const { return count ? sum/count : 0; }
+	};
+
+	typedef std::map<std::string, MetricStatistics> Metrics;
+
+	/**
+	 * The maximal number of different timer identifiers.
+	 */
+	static const TimerId MaxTimerIds = 1 << 16;
+
+	/**
+	 * The id of a Timer that does not measure anything.
+	 */
+	static const TimerId NoTimer = MaxTimerIds;
 
 	TimingStatistics();
 
-	static void addTimer(const std::string& identifier, float elapsed);
+	/**
+	 * Read the timing program options. Call this after
+	 * util::ProgramOptions::init().
+	 */
+	static void init();
+
+	/**
+	 * Get the id of a timer identifier. The identifier is registered on its
+	 * first use, later lookups go through a thread-local cache. Throws
+	 * UsageError if the identifier is the name of a counter or gauge.
+	 */
+	static TimerId getTimerId(const std::string& identifier) { return getId(identifier, 0); }
+
+	/**
+	 * Get the identifier of a timer id.
+	 */
+	static const std::string& getIdentifier(TimerId id) { return *_instance._identifiers[id].load(std::memory_order_acquire); }
+
+	/**
+	 * Get the identifier of a timer id, or 0 if the id was not handed out yet.
+	 * Safe to call from signal handlers.
+	 */
+	static const char* findIdentifier(TimerId id);
+
+	/**
+	 * Enable or disable all timers. Also set by the --timing option.
+	 */
+	static void setEnabled(bool enabled);
+
+	static bool isEnabled() { return _enabled.load(std::memory_order_relaxed); }
+
+	/**
+	 * Time only scopes whose identifiers start with one of the given prefixes.
+	 * An empty list enables all identifiers. Also set by the --timing-prefixes
+	 * option.
+	 */
+	static void setPrefixes(const std::vector<std::string>& prefixes);
+
+	/**
+	 * Record only every n-th run of each scope in each thread. Also set by the
+	 * --timing-sample option.
+	 */
+	static void setSampling(unsigned int n) { _sampling = std::max(1u, n); }
+
+	/**
+	 * Enable or disable reading the hardware performance counters in Timers.
+	 * Returns false (and leaves the counters disabled) if the counters are not
+	 * available in the calling thread. Also set by the --timing-counters
+	 * option.
+	 */
+	static bool setCountersEnabled(bool enabled);
+
+	static bool countersEnabled() { return _countersEnabled; }
+
+	/**
+	 * Enable or disable counting heap allocations in Timers. Returns false
+	 * (and leaves the counting disabled) if the allocation tracker is not
+	 * compiled in. Also set by the --timing-allocations option.
+	 */
+	static bool setAllocationsEnabled(bool enabled);
+
+	static bool allocationsEnabled() { return _allocationsEnabled; }
+
+	/**
+	 * Decide whether the current run of a timer with the given id should be
+	 * measured.
+	 */
+	static bool shouldTime(TimerId id) {
+
+		if (!_instance._timerEnabled[id].load(std::memory_order_relaxed))
+			return false;
+
+		return _sampling == 1 || sample(id);
+	}
+
+	/**
+	 * Get the id of a counter or gauge, see UTIL_COUNT and UTIL_GAUGE. Throws
+	 * UsageError if the name is already used for a timer or a metric of
+	 * another kind.
+	 */
+	static TimerId getMetricId(const std::string& name, MetricKind kind) { return getId(name, kind); }
+
+	/**
+	 * Add n to the counter with the given id in the current thread.
+	 */
+	static void count(TimerId id, uint64_t n) {
+
+		ThreadMetric& metric = getThreadMetric(id);
+		metric.count.store(metric.count.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Record the value of the gauge with the given id in the current thread.
+	 */
+	static void gauge(TimerId id, double value);
+
+	/**
+	 * Add a measurement for the given identifier, with the wall and CPU time
+	 * in seconds.
+	 */
+	static void addTimer(const std::string& identifier, float elapsed, float cpu = 0);
+
+	/**
+	 * Notify the statistics that a timer with the given id was started in the
+	 * current thread.
+	 */
+	static void enterScope(TimerId id);
+
+	/**
+	 * Notify the statistics that the given timer, which is the last timer
+	 * started in the current thread, stopped.
+	 */
+	static void leaveScope(const Timer& timer);
+
+	/**
+	 * Enable or disable recording of begin and end times of each timer, to be
+	 * exported with writeTrace(). Also enabled by the --timing-trace option.
+	 */
+	static void setTraceEnabled(bool enabled) { _traceEnabled = enabled; }
+
+	/**
+	 * Write all timer events recorded so far in the Chrome Trace Event JSON
+	 * format, which can be opened in chrome://tracing or Perfetto.
+	 */
+	static void writeTrace(const std::string& filename);
+
+	/**
+	 * Merge the times recorded by all threads so far into the global
+	 * statistics.
+	 */
+	static void flush();
+
+	/**
+	 * Get the statistics of all identifiers recorded so far. If reset is true,
+	 * the statistics and the call tree are cleared afterwards, such that the
+	 * next snapshot (and the summary at the end of the program) contains only
+	 * later times.
+	 */
+	static Times snapshot(bool reset = false);
+
+	/**
+	 * Get the statistics of all counters and gauges. If reset is true, the
+	 * next snapshot contains only later updates (except for the minimum and
+	 * maximum of gauges, which are kept since the start of the program).
+	 */
+	static Metrics snapshotMetrics(bool reset = false);
+
+	/**
+	 * Clear all statistics and metrics recorded so far.
+	 */
+	static void reset();
+
+	/**
+	 * Output formats for the summary.
+	 */
+	enum Format {
+
+		// a fixed-width table for humans (default)
+		Table,
+
+		// one line per identifier with a header line
+		Csv,
+
+		// an object with one entry per identifier in "timers"
+		Json
+	};
+
+	/**
+	 * Print a table of the given statistics.
+	 */
+	static void printSummary(std::ostream& out, const Times& times);
+
+	/**
+	 * Print a table of the given counters and gauges.
+	 */
+	static void printMetrics(std::ostream& out, const Metrics& metrics);
+
+	/**
+	 * Write the given statistics and metrics in the given format. The column
+	 * names of Csv are the keys of Json, times are in seconds. In Csv, the
+	 * metrics follow the timers after an empty line.
+	 */
+	static void writeSummary(std::ostream& out, const Times& times, Format format, const Metrics& metrics = Metrics());
+
+	/**
+	 * Start a background thread that writes the summary of the times recorded
+	 * in the last interval every interval seconds. Reports are appended to
+	 * the given file, or sent to the log channel timinglog if filename is
+	 * empty. A running reporter is stopped first.
+	 */
+	static void startReporter(double interval, const std::string& filename = "");
+
+	/**
+	 * Stop the background reporter, after writing a last report.
+	 */
+	static void stopReporter();
 
 	~TimingStatistics();
 
 private:
 
+	// the slot of one counter or gauge in one thread, only written by the
+	// owning thread
+	struct ThreadMetric {
+
+		std::atomic<uint64_t> count;
+		std::atomic<double>   sum;
+		std::atomic<double>   min;
+		std::atomic<double>   max;
+		std::atomic<double>   last;
+
+		// when last was set, in nanoseconds on the steady clock
+		std::atomic<uint64_t> stamp;
+	};
+
+	static const int MetricPageBits = 8;
+	static const int MetricPageSize = 1 << MetricPageBits;
+
+	// the metric slots of one thread, allocated in pages of MetricPageSize
+	// on first use
+	struct ThreadMetrics {
+
+		ThreadMetrics();
+
+		~ThreadMetrics();
+
+		ThreadMetric* addPage(TimerId id);
+
+		std::atomic<ThreadMetric*> pages[(MaxTimerIds >> MetricPageBits) + 1];
+	};
+
+	// the totals of one metric over several threads
+	struct MetricTotals {
+
+		MetricTotals() : count(0), sum(0), min(0), max(0), last(0), stamp(0) {}
+
+		void add(const ThreadMetric& metric);
+
+		void add(const MetricTotals& totals);
+
+		uint64_t count;
+		double   sum;
+		double   min;
+		double   max;
+		double   last;
+		uint64_t stamp;
+	};
+
+	static ThreadMetric& getThreadMetric(TimerId id) {
+
+		ThreadMetrics* metrics = _threadMetrics;
+		if (!metrics) {
+
+			metrics = initThreadMetrics();
+			if (!metrics)
+				return discardedMetric();
+		}
+
+		ThreadMetric* page = metrics->pages[id >> MetricPageBits].load(std::memory_order_relaxed);
+		if (!page)
+			page = metrics->addPage(id);
+
+		return page[id & (MetricPageSize - 1)];
+	}
+
+	// the metrics of the current thread, 0 if they were released already
+	static ThreadMetrics* initThreadMetrics();
+
+	// the target of updates after the metrics of a thread were released
+	static ThreadMetric& discardedMetric();
+
+	// the current totals of all metrics, _mutex has to be held
+	std::vector<MetricTotals> collectMetrics();
+
+	// the metrics since the given baseline, which is updated if reset is set,
+	// _mutex has to be held
+	Metrics metricsSince(std::vector<MetricTotals>& baseline, std::chrono::steady_clock::time_point& begin, bool reset);
+
+	// the times recorded by one thread
+	struct ThreadTimes {
+
+		ThreadTimes();
+
+		~ThreadTimes();
+
+		// only contended while the buffer is merged
+		std::mutex mutex;
+
+		// the statistics of each timer id, allocated on the first run of the
+		// timer in this thread
+		std::vector<std::unique_ptr<Statistics> > times;
+
+		// cache for getTimerId()
+		std::unordered_map<std::string, TimerId> timerIds;
+
+		// the number of runs of each timer id since the last sample
+		std::vector<unsigned int> skipped;
+
+		CallTreeNode callTree;
+
+		// the path from the root of the call tree to the current scope
+		std::vector<CallTreeNode*> scopes;
+
+		// a sequential number for trace events
+		int id;
+
+		struct Event {
+
+			TimerId  identifier;
+			uint64_t begin;
+			uint64_t duration;
+		};
+
+		std::vector<Event> events;
+
+		ThreadMetrics metrics;
+	};
+
+	// a trace event of any thread
+	struct TraceEvent {
+
+		TimerId  identifier;
+		int      thread;
+		uint64_t begin;
+		uint64_t duration;
+	};
+
+	static ThreadTimes& getThreadTimes();
+
+	// get the id of a timer (kind 0) or metric, timers and metrics share the
+	// ids
+	static TimerId getId(const std::string& name, unsigned char kind);
+
+	// throw UsageError if the id was registered for another kind
+	static void checkKind(const std::string& name, TimerId id, unsigned char kind) {
+
+		unsigned char registered = _instance._metricKinds[id].load(std::memory_order_relaxed);
+
+		if (registered != kind)
+			kindMismatch(name, registered, kind);
+	}
+
+	static void kindMismatch(const std::string& name, unsigned char registered, unsigned char kind);
+
+	// get the statistics of the given id in the current thread, the thread's
+	// mutex has to be held
+	static Statistics& getStatistics(ThreadTimes& threadTimes, TimerId id);
+
+	// decide whether to sample the current run of the given timer
+	static bool sample(TimerId id);
+
+	// whether the given identifier should be timed, _timerIdsMutex has to be
+	// held
+	bool isEnabled(const std::string& identifier);
+
+	// recompute _timerEnabled for all ids, _timerIdsMutex has to be held
+	void updateEnabled();
+
+	void printCallTree(std::ostream& out);
+
+	void printCallTreeNode(std::ostream& out, TimerId id, const CallTreeNode& node, int depth, int width, double parentTime);
+
+	// move the content of a thread's buffer into _times, _mutex has to be held
+	void merge(ThreadTimes& threadTimes);
+
+	static void writeCsv(std::ostream& out, const Times& times, const Metrics& metrics);
+
+	static void writeJson(std::ostream& out, const Times& times, const Metrics& metrics);
+
+	// the main loop of the reporter thread
+	void reportLoop();
+
+	// write the summary of the current interval
+	void report(double seconds);
+
 	static TimingStatistics _instance;
 
+	// protects _times, _interval, _collectInterval and _threads
+	std::mutex _mutex;
+
 	Times _times;
+
+	CallTreeNode _callTree;
+
+	std::set<ThreadTimes*> _threads;
+
+	int _nextThreadId;
+
+	std::vector<TraceEvent> _traceEvents;
+
+	// protects _timerIds and _prefixes
+	std::mutex _timerIdsMutex;
+
+	std::map<std::string, TimerId> _timerIds;
+
+	// the identifiers of all timer ids (and NoTimer), can be read without
+	// locking
+	std::atomic<const std::string*> _identifiers[MaxTimerIds + 1];
+
+	// whether to time each id, false for NoTimer
+	std::atomic<bool> _timerEnabled[MaxTimerIds + 1];
+
+	TimerId _numTimerIds;
+
+	std::vector<std::string> _prefixes;
+
+	std::string _noTimerIdentifier;
+
+	// the kind of each metric id, 0 for timers
+	std::atomic<unsigned char> _metricKinds[MaxTimerIds + 1];
+
+	// the metric totals of threads that ended
+	std::vector<MetricTotals> _endedThreadMetrics;
+
+	// the totals at the last reset and the last report, and when they were
+	// taken
+	std::vector<MetricTotals> _metricsBaseline;
+	std::vector<MetricTotals> _intervalMetricsBaseline;
+
+	std::chrono::steady_clock::time_point _metricsBegin;
+	std::chrono::steady_clock::time_point _intervalMetricsBegin;
+
+	static thread_local ThreadMetrics* _threadMetrics;
+
+	static std::atomic<bool> _enabled;
+
+	static bool _countersEnabled;
+
+	static bool _allocationsEnabled;
+
+	static unsigned int _sampling;
+
+	std::string _traceFile;
+
+	Format _format;
+
+	std::string _outputFile;
+
+	// statistics of the current reporter interval, collected if
+	// _collectInterval is set
+	Times _interval;
+
+	bool _collectInterval;
+
+	std::thread _reporter;
+
+	// protects _stopReporter
+	std::mutex _reporterMutex;
+
+	std::condition_variable _reporterWakeup;
+
+	bool _stopReporter;
+
+	double _reportInterval;
+
+	std::string _reportFile;
+
+	static bool _traceEnabled;
+
+	bool _showCallTree;
 };
 
+/**
+ * Measures the time between its construction and destruction and reports it
+ * to TimingStatistics.
+ *
+ * The clock used by all Timers can be selected with Timer::setClock():
+ *
+ *   Timer::Cpu   wall time from std::chrono::steady_clock and the CPU time of
+ *                the current thread (default)
+ *
+ *   Timer::Wall  wall time from std::chrono::steady_clock only
+ *
+ *   Timer::Tsc   wall time from the time stamp counter of the CPU, calibrated
+ *                against std::chrono::steady_clock (only on x86, assumes an
+ *                invariant TSC)
+ *
+ * Reading the thread CPU time is a system call, so for fine-grained scopes,
+ * Wall or Tsc are considerably cheaper.
+ *
+ * The begin and end of all Timers with a valid id (sampled or not) are also
+ * recorded by the FlightRecorder.
+ */
 class Timer {
 
 public:
 
-	Timer(std::string identifier) :
-		_identifier(identifier) {
+	enum Clock {
 
-		_timer.start();
+		Cpu,
+		Wall,
+		Tsc
+	};
+
+	Timer(TimerId id) :
+		_id(id),
+		_active(TimingStatistics::shouldTime(id)),
+		_clock(_clockSource),
+		_counters(TimingStatistics::countersEnabled()),
+		_allocations(TimingStatistics::allocationsEnabled()),
+		_stopped(false) {
+
+		if (_id != TimingStatistics::NoTimer)
+			FlightRecorder::scopeBegin(_id);
+
+		if (!_active)
+			return;
+
+		TimingStatistics::enterScope(_id);
+		start();
 	}
 
+	Timer(const std::string& identifier) :
+		Timer(TimingStatistics::getTimerId(identifier)) {}
+
 	~Timer() {
 
-		_timer.stop();
-		TimingStatistics::addTimer(getIdentifier(), elapsed());
+		if (_id != TimingStatistics::NoTimer)
+			FlightRecorder::scopeEnd(_id);
+
+		if (!_active)
+			return;
+
+		stop();
+		TimingStatistics::leaveScope(*this);
 	}
 
-	const std::string& getIdentifier() const { return _identifier; }
+	/**
+	 * False, if this timer was disabled or not sampled. Inactive timers do not
+	 * measure anything.
+	 */
+	bool isActive() const { return _active; }
+
+	const std::string& getIdentifier() const { return TimingStatistics::getIdentifier(_id); }
+
+	TimerId getId() const { return _id; }
 
 	/**
-	 * Return the elapsed time in seconds.
+	 * Return the elapsed wall time in seconds.
 	 */
 	float elapsed() const;
 
+	/**
+	 * Return the elapsed CPU time of the current thread in seconds, if the
+	 * clock is Cpu. Otherwise, returns 0.
+	 */
+	float cpuElapsed() const;
+
+	/**
+	 * Return the start time in nanoseconds on the steady clock.
+	 */
+	uint64_t startTime() const;
+
+	/**
+	 * Get the differences of the hardware counters between start and stop of
+	 * this timer. Returns false if the timer did not read the counters.
+	 */
+	bool counterDeltas(uint64_t deltas[PerfCounters::NumCounters]) const;
+
+	/**
+	 * Get the number of allocations and allocated bytes of this timer
+	 * (without nested timers), and the peak of live bytes while this timer was
+	 * running. Returns false if the timer did not count allocations.
+	 */
+	bool allocationCounts(uint64_t& allocations, uint64_t& bytes, int64_t& peak) const;
+
+	/**
+	 * Set the clock for all Timers created afterwards. Selecting Tsc
+	 * calibrates the time stamp counter, which takes about 20ms.
+	 */
+	static void setClock(Clock clock);
+
+	static Clock getClock() { return _clockSource; }
+
 private:
 
-	std::string _identifier;
+	inline void start() {
+
+		if (_clock == Cpu)
+			_cpuStart = threadCpuTime();
+
+		if (_counters)
+			_counters = PerfCounters::threadCounters().read(_counterStart);
+
+		if (_allocations)
+			startAllocations();
+
+		_start = now(_clock);
+	}
+
+	inline void stop() {
+
+		_stop = now(_clock);
+
+		if (_allocations)
+			stopAllocations();
+
+		if (_counters)
+			_counters = PerfCounters::threadCounters().read(_counterStop);
+
+		if (_clock == Cpu)
+			_cpuStop = threadCpuTime();
+
+		_stopped = true;
+	}
+
+	// the current wall time in nanoseconds or TSC ticks
+	static inline uint64_t now(Clock clock) {
+
+#if defined(__x86_64__) || defined(__i386__)
+		if (clock == Tsc)
+			return __rdtsc();
+#endif
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void startAllocations();
+
+	void stopAllocations();
+
+	// the CPU time of the current thread in nanoseconds
+	static inline uint64_t threadCpuTime() {
+
+		timespec t;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+
+		return uint64_t(t.tv_sec)*1000000000 + t.tv_nsec;
+	}
+
+	// the relation between TSC ticks and the steady clock
+	struct TscCalibration {
+
+		TscCalibration();
+
+		uint64_t ticks;
+		uint64_t nanoseconds;
+		double   secondsPerTick;
+	};
+
+	static const TscCalibration& tscCalibration();
+
+	TimerId _id;
+
+	bool _active;
+
+	Clock _clock;
+
+	// read the hardware counters, reset if reading fails
+	bool _counters;
+
+	// count allocations
+	bool _allocations;
+
+	bool _stopped;
+
+	uint64_t _start;
+	uint64_t _stop;
+	uint64_t _cpuStart;
+	uint64_t _cpuStop;
+	uint64_t _counterStart[PerfCounters::NumCounters];
+	uint64_t _counterStop[PerfCounters::NumCounters];
+
+	// the allocation counters of the thread when this timer started
+	AllocationTracker::Counts _allocationsStart;
+
+	// the allocations of nested timers
+	uint64_t _childAllocations;
+	uint64_t _childBytes;
+
+	// the results of this timer
+	uint64_t _allocationCount;
+	uint64_t _allocatedBytes;
+	int64_t  _peakBytes;
+
+	// the enclosing timer that counts allocations
+	Timer* _parent;
+
+	// the innermost running timer of this thread that counts allocations
+	static thread_local Timer* _current;
 
-	boost::timer::cpu_timer _timer;
+	static Clock _clockSource;
 };
 
 #endif // UTIL_TIMING_H__
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "timing_summary.h"
+
+TimingSummary::TimingSummary() {
+
+	clear();
+}
+
+void
+TimingSummary::add(double seconds) {
+
+	uint64_t ns = static_cast<uint64_t>(std::max(0.0, seconds)*1e9 + 0.5);
+
+	_count++;
+	_sum += ns;
+	_min  = std::min(_min, ns);
+	_max  = std::max(_max, ns);
+
+	_buckets[bucket(ns)]++;
+}
+
+void
+TimingSummary::merge(const TimingSummary& other) {
+
+	_count += other._count;
+	_sum   += other._sum;
+	_min    = std::min(_min, other._min);
+	_max    = std::max(_max, other._max);
+
+	for (int b = 0; b < NumBuckets; b++)
+		_buckets[b] += other._buckets[b];
+}
+
+void
+TimingSummary::clear() {
+
+	_count = 0;
+	_sum   = 0;
+	_min   = std::numeric_limits<uint64_t>::max();
+	_max   = 0;
+
+	std::fill(_buckets, _buckets + NumBuckets, 0);
+}
+
+double
+TimingSummary::quantile(double q) const {
+
+	if (_count == 0)
+		return 0;
+
+	// the rank of the value we are looking for, starting at 1
+	uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q*_count)));
+
+	if (rank == 1)
+		return min();
+	if (rank >= _count)
+		return max();
+
+	uint64_t seen = 0;
+	int b = 0;
+	for (; b < NumBuckets - 1; b++) {
+
+		seen += _buckets[b];
+		if (seen >= rank)
+			break;
+	}
+
+	// report the center of the bucket, but never beyond the extreme values
+	uint64_t lower  = lowerBound(b);
+	uint64_t upper  = (b + 1 < NumBuckets ? lowerBound(b + 1) : _max + 1);
+	uint64_t center = lower + (upper - lower - 1)/2;
+
+	return std::min(std::max(center, _min), _max)*1e-9;
+}
+
+int
+TimingSummary::bucket(uint64_t ns) {
+
+	if (ns < (uint64_t(1) << SubBucketBits))
+		return static_cast<int>(ns);
+
+	int exponent = 63 - __builtin_clzll(ns);
+
+	if (exponent > MaxExponent)
+		return NumBuckets - 1;
+
+	// the SubBucketBits bits after the leading one select the sub-bucket
+	int subBucket = static_cast<int>(ns >> (exponent - SubBucketBits)) & ((1 << SubBucketBits) - 1);
+
+	return ((exponent - SubBucketBits + 1) << SubBucketBits) + subBucket;
+}
+
+uint64_t
+TimingSummary::lowerBound(int b) {
+
+	if (b < (1 << SubBucketBits))
+		return b;
+
+	int exponent  = (b >> SubBucketBits) + SubBucketBits - 1;
+	int subBucket = b & ((1 << SubBucketBits) - 1);
+
+	return (uint64_t((1 << SubBucketBits) + subBucket)) << (exponent - SubBucketBits);
+}
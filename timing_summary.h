@@ -0,0 +1,70 @@
+#ifndef UTIL_TIMING_SUMMARY_H__
+#define UTIL_TIMING_SUMMARY_H__
+
+#include <cstdint>
+
+/**
+ * A fixed-size summary of a stream of durations.
+ *
+ * Keeps the exact count, sum, minimum, and maximum, and a log-linear histogram
+ * (similar to an HDR histogram) from which quantiles can be estimated.
+ * Durations are recorded in nanoseconds. Each power of two is split into
+ * 2^SubBucketBits buckets, such that the relative error of a quantile is at
+ * most 2^-(SubBucketBits+1), i.e., about 3%. Durations below 2^SubBucketBits
+ * nanoseconds are counted exactly, durations of 2^(MaxExponent+1) nanoseconds
+ * (about 9.8 hours) and more are counted in the last bucket. With the default
+ * parameters, a summary takes about 5kB.
+ */
+class TimingSummary {
+
+public:
+
+	static const int SubBucketBits = 4;
+	static const int MaxExponent   = 44;
+	static const int NumBuckets    = (MaxExponent - SubBucketBits + 2) << SubBucketBits;
+
+	TimingSummary();
+
+	/**
+	 * Add a duration in seconds.
+	 */
+	void add(double seconds);
+
+	/**
+	 * Add all durations of another summary.
+	 */
+	void merge(const TimingSummary& other);
+
+	void clear();
+
+	uint64_t count() const { return _count; }
+
+	/**
+	 * Sum, minimum, maximum, and mean of all durations in seconds.
+	 */
+	double sum()  const { return _sum*1e-9; }
+	double min()  const { return _count ? _min*1e-9 : 0; }
+	double max()  const { return _max*1e-9; }
+	double mean() const { return _count ? sum()/_count : 0; }
+
+	/**
+	 * Estimate the q-quantile (with 0 <= q <= 1) in seconds.
+	 */
+	double quantile(double q) const;
+
+private:
+
+	static int bucket(uint64_t ns);
+
+	// the smallest value in bucket b
+	static uint64_t lowerBound(int b);
+
+	uint64_t _count;
+	uint64_t _sum;
+	uint64_t _min;
+	uint64_t _max;
+
+	uint64_t _buckets[NumBuckets];
+};
+
+#endif // UTIL_TIMING_SUMMARY_H__
@@ -0,0 +1,424 @@
+/**
+ * Formats the messages of a binary log written with --log-binary:
+ *
+ *   log_decode --input log.bin --show-time
+ *
+ * The messages of all threads are sorted by their time stamps and written to
+ * std::cout, one line per message, like the channels would have written them
+ * in text mode.
+ *
+ * The file layout (all numbers in the byte order of the writing machine):
+ *
+ *   header:   uint64 magic, uint32 version, uint64 time stamp,
+ *             uint64 monotonic time (ns), uint64 real time (ns since epoch)
+ *
+ *   callsite: uint8 1, uint32 id, uint8 level, string channel,
+ *             string prefix, string file, uint32 line, string argument types,
+ *             string format
+ *
+ *   chunk:    uint8 2, uint32 thread, uint64 time stamp,
+ *             uint64 monotonic time (ns), uint32 size, size bytes of messages
+ *
+ *   message:  uint32 callsite id, uint64 time stamp, arguments
+ *
+ * Strings are a uint32 length followed by the characters. The encoding of
+ * the arguments is given by their types, see BinaryLog::ArgumentType.
+ *
+ * With --check, a binary log with arguments of all types is written to a
+ * temporary file and decoded, to verify that encoder and decoder agree.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <util/Logger.h>
+#include <util/ProgramOptions.h>
+#include <util/binary_log.h>
+#include <util/exceptions.h>
+
+util::ProgramOption optionInput(
+		util::_long_name = "input",
+		util::_description_text = "The binary log to decode.",
+		util::_argument_sketch = "file");
+
+util::ProgramOption optionShowTime(
+		util::_long_name = "show-time",
+		util::_description_text = "Start each line with the time since the log was opened, in seconds.");
+
+util::ProgramOption optionShowThread(
+		util::_long_name = "show-thread",
+		util::_description_text = "Start each line with the number of the thread that logged the message.");
+
+util::ProgramOption optionShowChannelPrefix(
+		util::_long_name = "show-channel-prefix",
+		util::_description_text = "Show the prefix of the channel of each message.",
+		util::_default_value = true);
+
+util::ProgramOption optionCheck(
+		util::_long_name = "check",
+		util::_description_text = "Write a binary log with arguments of all types to a temporary file, decode it, and compare the messages to the expected text.");
+
+logger::LogChannel checklog("checklog", "[check] ");
+
+struct Callsite {
+
+	std::string prefix;
+	std::string types;
+	std::string format;
+};
+
+struct Message {
+
+	uint64_t    timestamp;
+	uint32_t    thread;
+	std::string prefix;
+	std::string text;
+
+	bool operator<(const Message& other) const { return timestamp < other.timestamp; }
+};
+
+/**
+ * Reads numbers and strings from a buffer, with bounds checks.
+ */
+class Reader {
+
+public:
+
+	Reader(const char* data, size_t size, const std::string& what) :
+		_data(data),
+		_size(size),
+		_pos(0),
+		_what(what) {}
+
+	bool atEnd() const { return _pos == _size; }
+
+	template <typename T>
+	T read() {
+
+		T t;
+		std::memcpy(&t, take(sizeof(T)), sizeof(T));
+
+		return t;
+	}
+
+	std::string readString() {
+
+		uint32_t length = read<uint32_t>();
+
+		return std::string(take(length), length);
+	}
+
+	const char* take(size_t n) {
+
+		if (_size - _pos < n)
+			UTIL_THROW_EXCEPTION(
+					IOError,
+					_what << " is truncated at offset " << _pos);
+
+		const char* p = _data + _pos;
+		_pos += n;
+
+		return p;
+	}
+
+private:
+
+	const char* _data;
+	size_t      _size;
+	size_t      _pos;
+	std::string _what;
+};
+
+/**
+ * Format the arguments of a message in reader according to the callsite.
+ */
+std::string format(const Callsite& callsite, Reader& reader) {
+
+	std::stringstream text;
+
+	const char* format = callsite.format.c_str();
+
+	for (char type : callsite.types) {
+
+		const char* placeholder = std::strstr(format, "{}");
+
+		if (placeholder) {
+
+			text.write(format, placeholder - format);
+			format = placeholder + 2;
+
+		} else {
+
+			// more arguments than placeholders
+			text << format << " ";
+			format = "";
+		}
+
+		switch (type) {
+
+			case logger::BinaryLog::Signed:
+				text << reader.read<int64_t>();
+				break;
+
+			case logger::BinaryLog::Unsigned:
+				text << reader.read<uint64_t>();
+				break;
+
+			case logger::BinaryLog::Double:
+				text << reader.read<double>();
+				break;
+
+			case logger::BinaryLog::Bool:
+				text << (reader.read<uint8_t>() ? 1 : 0);
+				break;
+
+			case logger::BinaryLog::Char:
+				text << reader.read<char>();
+				break;
+
+			case logger::BinaryLog::String:
+				text << reader.readString();
+				break;
+
+			case logger::BinaryLog::Pointer:
+				text << "0x" << std::hex << reader.read<uint64_t>() << std::dec;
+				break;
+
+			default:
+				UTIL_THROW_EXCEPTION(
+						IOError,
+						"unknown argument type '" << type << "' in callsite \"" << callsite.format << "\"");
+		}
+	}
+
+	text << format;
+
+	return text.str();
+}
+
+/**
+ * Read all messages of a binary log, sorted by their time stamps. The time
+ * stamps are converted to nanoseconds since the log was opened.
+ */
+std::vector<Message> decode(const std::string& filename) {
+
+	std::ifstream in(filename.c_str(), std::ios_base::binary);
+	if (!in)
+		UTIL_THROW_EXCEPTION(IOError, "can not open " << filename);
+
+	std::stringstream content;
+	content << in.rdbuf();
+	std::string data = content.str();
+
+	Reader file(data.data(), data.size(), filename);
+
+	if (file.read<uint64_t>() != logger::BinaryLog::Magic)
+		UTIL_THROW_EXCEPTION(IOError, filename << " is not a binary log");
+
+	uint32_t version = file.read<uint32_t>();
+	if (version != logger::BinaryLog::Version)
+		UTIL_THROW_EXCEPTION(IOError, filename << " has the unsupported version " << version);
+
+	uint64_t startTimestamp = file.read<uint64_t>();
+	uint64_t startMonotonic = file.read<uint64_t>();
+	file.read<uint64_t>(); // real time
+
+	// the last pair of time stamp and monotonic time, to convert the time
+	// stamps
+	uint64_t lastTimestamp = startTimestamp;
+	uint64_t lastMonotonic = startMonotonic;
+
+	std::map<uint32_t, Callsite> callsites;
+	std::vector<Message>         messages;
+
+	while (!file.atEnd()) {
+
+		uint8_t type = file.read<uint8_t>();
+
+		if (type == logger::BinaryLog::CallsiteRecord) {
+
+			uint32_t  id       = file.read<uint32_t>();
+			Callsite& callsite = callsites[id];
+
+			file.read<uint8_t>(); // level
+			file.readString();    // channel
+			callsite.prefix = file.readString();
+			file.readString();    // file
+			file.read<uint32_t>(); // line
+			callsite.types  = file.readString();
+			callsite.format = file.readString();
+
+		} else if (type == logger::BinaryLog::ChunkRecord) {
+
+			uint32_t thread = file.read<uint32_t>();
+			lastTimestamp   = file.read<uint64_t>();
+			lastMonotonic   = file.read<uint64_t>();
+			uint32_t size   = file.read<uint32_t>();
+
+			Reader chunk(file.take(size), size, filename);
+
+			while (!chunk.atEnd()) {
+
+				uint32_t id = chunk.read<uint32_t>();
+
+				std::map<uint32_t, Callsite>::const_iterator callsite = callsites.find(id);
+				if (callsite == callsites.end())
+					UTIL_THROW_EXCEPTION(IOError, filename << " contains a message of the unknown callsite " << id);
+
+				Message message;
+				message.timestamp = chunk.read<uint64_t>();
+				message.thread    = thread;
+				message.prefix    = callsite->second.prefix;
+				message.text      = format(callsite->second, chunk);
+
+				messages.push_back(message);
+			}
+
+		} else {
+
+			UTIL_THROW_EXCEPTION(IOError, filename << " contains an unknown record type " << (int)type);
+		}
+	}
+
+	std::stable_sort(messages.begin(), messages.end());
+
+	double nanosecondsPerTick = 1;
+	if (lastTimestamp > startTimestamp && lastMonotonic > startMonotonic)
+		nanosecondsPerTick = double(lastMonotonic - startMonotonic)/(lastTimestamp - startTimestamp);
+
+	for (Message& message : messages)
+		message.timestamp = (double(message.timestamp) - double(startTimestamp))*nanosecondsPerTick;
+
+	return messages;
+}
+
+enum CheckEnum { First, Second, Third };
+
+/**
+ * Log arguments of all types in binary form and compare the decoded messages
+ * to the expected text. Returns the number of mismatches.
+ */
+int check() {
+
+	char filename[] = "/tmp/log_decode_check.XXXXXX";
+	int  fd = mkstemp(filename);
+	if (fd < 0)
+		UTIL_THROW_EXCEPTION(IOError, "can not create a temporary file");
+	close(fd);
+
+	logger::BinaryLog::open(filename);
+	checklog.setLogLevel(logger::All);
+	checklog.setBinary(true);
+
+	char        buffer[64] = "array";
+	char*       pointer    = buffer;
+	const char* constant   = "constant";
+	std::string string     = "string";
+	int         value      = 42;
+
+	LOG_BINARY(checklog, logger::User, "char* {} int {}", pointer, -7);
+	LOG_BINARY(checklog, logger::User, "char[] {} const char* {}", buffer, constant);
+	LOG_BINARY(checklog, logger::User, "string {} literal {}", string, "literal");
+	LOG_BINARY(checklog, logger::User, "enum {} bool {} {}", Third, true, false);
+	LOG_BINARY(checklog, logger::User, "char {} unsigned {} double {}", 'x', 7u, 0.5);
+	LOG_BINARY(checklog, logger::User, "pointer {}", (const void*)&value);
+	LOG_BINARY(checklog, logger::User, "no arguments");
+	LOG_BINARY(checklog, logger::User, "extra", 1, pointer);
+
+	logger::BinaryLog::flush();
+
+	std::stringstream address;
+	address << "0x" << std::hex << reinterpret_cast<uintptr_t>(&value);
+
+	std::vector<std::string> expected = {
+		"char* array int -7",
+		"char[] array const char* constant",
+		"string string literal literal",
+		"enum 2 bool 1 0",
+		"char x unsigned 7 double 0.5",
+		"pointer " + address.str(),
+		"no arguments",
+		"extra 1 array"
+	};
+
+	std::vector<Message> messages;
+
+	try {
+
+		messages = decode(filename);
+
+	} catch (...) {
+
+		std::remove(filename);
+		throw;
+	}
+
+	std::remove(filename);
+
+	int mismatches = 0;
+
+	for (size_t i = 0; i < std::max(messages.size(), expected.size()); i++) {
+
+		std::string decoded = (i < messages.size() ? messages[i].text : "<missing>");
+		std::string wanted  = (i < expected.size() ? expected[i] : "<none>");
+
+		if (decoded != wanted) {
+
+			std::cerr << "expected \"" << wanted << "\", decoded \"" << decoded << "\"" << std::endl;
+			mismatches++;
+		}
+	}
+
+	std::cout << (mismatches ? "check failed" : "check passed") << std::endl;
+
+	return mismatches;
+}
+
+int main(int argc, char** argv) {
+
+	try {
+
+		util::ProgramOptions::init(argc, argv);
+
+		if (optionCheck)
+			return (check() == 0 ? 0 : 1);
+
+		if (!optionInput)
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					optionInput.getLongParam() << " has to be given");
+
+		std::vector<Message> messages = decode(optionInput.as<std::string>());
+
+		for (const Message& message : messages) {
+
+			if (optionShowTime)
+				std::cout << std::fixed << std::setprecision(6) << std::setw(12) << message.timestamp*1e-9 << " ";
+
+			if (optionShowThread)
+				std::cout << "T" << message.thread << " ";
+
+			if (optionShowChannelPrefix)
+				std::cout << message.prefix;
+
+			std::cout << message.text << "\n";
+		}
+
+		return 0;
+
+	} catch (boost::exception& e) {
+
+		handleException(e, std::cerr);
+		return 1;
+	}
+}
@@ -0,0 +1,403 @@
+/**
+ * Compares two timing summaries written with --timing-format=csv or
+ * --timing-format=json and reports identifiers whose median or p99 got slower
+ * by more than a threshold:
+ *
+ *   timing_diff --baseline old.csv --current new.csv --threshold 10
+ *
+ * The exit status is 0 if no identifier regressed, 1 if at least one did, and
+ * 2 if the files could not be read. Identifiers that are only contained in one
+ * of the files are listed, but not counted as regressions.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <util/ProgramOptions.h>
+#include <util/exceptions.h>
+
+util::ProgramOption optionBaseline(
+		util::_long_name = "baseline",
+		util::_description_text = "The timing summary of the reference run (CSV or JSON).",
+		util::_argument_sketch = "file");
+
+util::ProgramOption optionCurrent(
+		util::_long_name = "current",
+		util::_description_text = "The timing summary of the run to check (CSV or JSON).",
+		util::_argument_sketch = "file");
+
+util::ProgramOption optionThreshold(
+		util::_long_name = "threshold",
+		util::_description_text = "The relative slowdown of the median or p99 in percent that counts as a regression.",
+		util::_argument_sketch = "percent",
+		util::_default_value = 10);
+
+util::ProgramOption optionMinRuns(
+		util::_long_name = "min-runs",
+		util::_description_text = "Ignore identifiers with fewer runs than this in either file.",
+		util::_default_value = 1);
+
+// the values of all columns per identifier
+typedef std::map<std::string, std::map<std::string, double> > Timings;
+
+/**
+ * Split a CSV line into its fields. Fields can be quoted with '"', a quote
+ * within a quoted field is written as '""'.
+ */
+std::vector<std::string> splitCsv(const std::string& line) {
+
+	std::vector<std::string> fields(1);
+	bool quoted = false;
+
+	for (std::string::size_type i = 0; i < line.size(); i++) {
+
+		char c = line[i];
+
+		if (quoted) {
+
+			if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+
+				fields.back() += '"';
+				i++;
+
+			} else if (c == '"') {
+
+				quoted = false;
+
+			} else {
+
+				fields.back() += c;
+			}
+
+		} else if (c == '"') {
+
+			quoted = true;
+
+		} else if (c == ',') {
+
+			fields.push_back("");
+
+		} else {
+
+			fields.back() += c;
+		}
+	}
+
+	return fields;
+}
+
+Timings readCsv(std::istream& in, const std::string& filename) {
+
+	Timings timings;
+
+	std::string line;
+	if (!std::getline(in, line))
+		UTIL_THROW_EXCEPTION(IOError, filename << " is empty");
+
+	std::vector<std::string> columns = splitCsv(line);
+	if (columns.empty() || columns[0] != "identifier")
+		UTIL_THROW_EXCEPTION(IOError, filename << " is not a timing summary (expected the column \"identifier\" first)");
+
+	// the timers end at the first empty line, followed by the metrics
+	while (std::getline(in, line) && !line.empty() && line != "\r") {
+
+		std::vector<std::string> fields = splitCsv(line);
+
+		std::map<std::string, double>& values = timings[fields[0]];
+		for (size_t i = 1; i < fields.size() && i < columns.size(); i++)
+			if (!fields[i].empty())
+				values[columns[i]] = std::atof(fields[i].c_str());
+	}
+
+	return timings;
+}
+
+/**
+ * A minimal reader for the JSON summaries written by TimingStatistics: an
+ * object with an array "timers" of flat objects with string and number
+ * values. Other members (like "metrics") are skipped.
+ */
+class JsonReader {
+
+public:
+
+	JsonReader(const std::string& text, const std::string& filename) :
+		_text(text),
+		_filename(filename),
+		_pos(0) {}
+
+	Timings read() {
+
+		Timings timings;
+
+		expect('{');
+		while (!consume('}')) {
+
+			std::string key = readString();
+			expect(':');
+
+			if (key != "timers") {
+
+				skipValue();
+
+			} else {
+
+				expect('[');
+				while (!consume(']')) {
+
+					readTimer(timings);
+					consume(',');
+				}
+			}
+
+			consume(',');
+		}
+
+		return timings;
+	}
+
+private:
+
+	void readTimer(Timings& timings) {
+
+		std::string identifier;
+		std::map<std::string, double> values;
+
+		expect('{');
+		while (!consume('}')) {
+
+			std::string key = readString();
+			expect(':');
+
+			if (key == "identifier")
+				identifier = readString();
+			else
+				values[key] = readNumber();
+
+			consume(',');
+		}
+
+		timings[identifier] = values;
+	}
+
+	std::string readString() {
+
+		expect('"');
+
+		std::string s;
+		while (_pos < _text.size() && _text[_pos] != '"') {
+
+			if (_text[_pos] == '\\')
+				_pos++;
+			if (_pos < _text.size())
+				s += _text[_pos++];
+		}
+
+		expect('"');
+
+		return s;
+	}
+
+	double readNumber() {
+
+		skipWhitespace();
+
+		const char* begin = _text.c_str() + _pos;
+		char* end;
+		double value = std::strtod(begin, &end);
+
+		if (end == begin)
+			error("a number");
+
+		_pos += end - begin;
+
+		return value;
+	}
+
+	void skipValue() {
+
+		skipWhitespace();
+
+		if (consume('[')) {
+
+			while (!consume(']')) {
+
+				skipValue();
+				consume(',');
+			}
+
+		} else if (consume('{')) {
+
+			while (!consume('}')) {
+
+				readString();
+				expect(':');
+				skipValue();
+				consume(',');
+			}
+
+		} else if (_pos < _text.size() && _text[_pos] == '"') {
+
+			readString();
+
+		} else {
+
+			readNumber();
+		}
+	}
+
+	bool consume(char c) {
+
+		skipWhitespace();
+
+		if (_pos < _text.size() && _text[_pos] == c) {
+
+			_pos++;
+			return true;
+		}
+
+		return false;
+	}
+
+	void expect(char c) {
+
+		if (!consume(c))
+			error(std::string("'") + c + "'");
+	}
+
+	void skipWhitespace() {
+
+		while (_pos < _text.size() && std::isspace(static_cast<unsigned char>(_text[_pos])))
+			_pos++;
+	}
+
+	void error(const std::string& expected) {
+
+		UTIL_THROW_EXCEPTION(
+				IOError,
+				_filename << " is not a timing summary: expected " << expected << " at offset " << _pos);
+	}
+
+	const std::string& _text;
+	std::string        _filename;
+	size_t             _pos;
+};
+
+Timings readTimings(const std::string& filename) {
+
+	std::ifstream in(filename.c_str());
+
+	if (!in)
+		UTIL_THROW_EXCEPTION(IOError, "can not open " << filename);
+
+	std::stringstream content;
+	content << in.rdbuf();
+	std::string text = content.str();
+
+	std::string::size_type first = text.find_first_not_of(" \t\r\n");
+	if (first != std::string::npos && text[first] == '{')
+		return JsonReader(text, filename).read();
+
+	std::istringstream lines(text);
+	return readCsv(lines, filename);
+}
+
+// the relative change from before to after in percent
+double change(double before, double after) {
+
+	if (before <= 0)
+		return 0;
+
+	return (after - before)/before*100;
+}
+
+int main(int argc, char** argv) {
+
+	try {
+
+		util::ProgramOptions::init(argc, argv);
+
+		if (!optionBaseline || !optionCurrent)
+			UTIL_THROW_EXCEPTION(
+					UsageError,
+					"both " << optionBaseline.getLongParam() << " and " << optionCurrent.getLongParam() << " have to be given");
+
+		Timings baseline = readTimings(optionBaseline.as<std::string>());
+		Timings current  = readTimings(optionCurrent.as<std::string>());
+
+		double threshold = optionThreshold;
+		double minRuns   = optionMinRuns;
+
+		size_t width = 10;
+		for (const Timings::value_type& p : current)
+			width = std::max(width, p.first.size());
+
+		std::cout
+				<< std::left << std::setw(width) << "identifier" << std::right
+				<< "   median before   median after   change"
+				<< "      p99 before      p99 after   change"
+				<< std::endl;
+
+		int regressions = 0;
+
+		for (const Timings::value_type& p : current) {
+
+			Timings::const_iterator before = baseline.find(p.first);
+			if (before == baseline.end())
+				continue;
+
+			std::map<std::string, double> b = before->second;
+			std::map<std::string, double> a = p.second;
+
+			if (b["runs"] < minRuns || a["runs"] < minRuns)
+				continue;
+
+			double medianChange = change(b["median"], a["median"]);
+			double p99Change    = change(b["p99"], a["p99"]);
+
+			bool regressed = (medianChange > threshold || p99Change > threshold);
+			if (regressed)
+				regressions++;
+
+			std::cout
+					<< std::left << std::setw(width) << p.first << std::right
+					<< std::scientific << std::setprecision(3)
+					<< std::setw(16) << b["median"] << std::setw(15) << a["median"]
+					<< std::fixed << std::setprecision(1)
+					<< std::setw(8) << medianChange << "%"
+					<< std::scientific << std::setprecision(3)
+					<< std::setw(16) << b["p99"] << std::setw(15) << a["p99"]
+					<< std::fixed << std::setprecision(1)
+					<< std::setw(8) << p99Change << "%"
+					<< (regressed ? "   REGRESSION" : "")
+					<< std::endl;
+		}
+
+		for (const Timings::value_type& p : baseline)
+			if (!current.count(p.first))
+				std::cout << "only in baseline: " << p.first << std::endl;
+
+		for (const Timings::value_type& p : current)
+			if (!baseline.count(p.first))
+				std::cout << "only in current: " << p.first << std::endl;
+
+		std::cout
+				<< std::endl << regressions << " identifier(s) regressed by more than "
+				<< std::defaultfloat << std::setprecision(6) << threshold << "%" << std::endl;
+
+		return (regressions > 0 ? 1 : 0);
+
+	} catch (boost::exception& e) {
+
+		handleException(e, std::cerr);
+		return 2;
+	}
+}